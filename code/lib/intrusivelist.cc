@@ -0,0 +1,286 @@
+// intrusivelist.cc
+//     	Routines to manage a doubly linked list of objects that carry
+//	their own links (see intrusivelist.h).  Nothing here allocates
+//	or frees memory.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::IntrusiveList
+//	Initialize a list, empty to start with.
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+IntrusiveList<T, Link>::IntrusiveList()
+{
+    first = last = NULL;
+    numInList = 0;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::~IntrusiveList
+//	Prepare a list for deallocation.  This does *NOT* touch the
+//	items still on the list (they may have been deleted already),
+//	so normally, the list should be empty when this is called.
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+IntrusiveList<T, Link>::~IntrusiveList()
+{
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::InsertBefore
+//	Link "item" into the list, in front of "next" (or at the end,
+//	if "next" is NULL).  The item must not be on any list that uses
+//	the same link.
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+void IntrusiveList<T, Link>::InsertBefore(T *item, T *next)
+{
+    IntrusiveLink<T> *link = &(item->*Link);
+
+    ASSERT(link->list == NULL);
+    link->list = this;
+    link->next = next;
+    if (next == NULL) {		// goes at the end
+	link->prev = last;
+	last = item;
+    } else {
+	link->prev = (next->*Link).prev;
+	(next->*Link).prev = item;
+    }
+    if (link->prev == NULL) {	// goes at the front
+	first = item;
+    } else {
+	(link->prev->*Link).next = item;
+    }
+    numInList++;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::Append
+//      Append an "item" to the end of the list.
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+void IntrusiveList<T, Link>::Append(T *item)
+{
+    InsertBefore(item, NULL);
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::Prepend
+//	Same as Append, only put "item" on the front.
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+void IntrusiveList<T, Link>::Prepend(T *item)
+{
+    InsertBefore(item, first);
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::RemoveFront
+//      Remove the first item from the front of the list.
+//	List must not be empty.
+//
+// Returns:
+//	The removed item.
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+T *IntrusiveList<T, Link>::RemoveFront()
+{
+    T *item = first;
+
+    ASSERT(!IsEmpty());
+    Remove(item);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::Remove
+//      Remove a specific item from the list.  Must be in the list!
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+void IntrusiveList<T, Link>::Remove(T *item)
+{
+    IntrusiveLink<T> *link = &(item->*Link);
+
+    ASSERT(IsInList(item));
+    if (link->prev == NULL) {
+	first = link->next;
+    } else {
+	(link->prev->*Link).next = link->next;
+    }
+    if (link->next == NULL) {
+	last = link->prev;
+    } else {
+	(link->next->*Link).prev = link->prev;
+    }
+    link->next = link->prev = NULL;
+    link->list = NULL;
+    numInList--;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::Apply
+//      Apply function to every item on a list.
+//
+//	"func" -- the function to apply
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+void IntrusiveList<T, Link>::Apply(void (*func)(T *)) const
+{
+    T *ptr;
+
+    for (ptr = first; ptr != NULL; ptr = (ptr->*Link).next) {
+        (*func)(ptr);
+    }
+}
+
+//----------------------------------------------------------------------
+// IntrusiveSortedList<T, Link>::Insert
+//      Insert an "item" into a list, so that the list elements are
+//	sorted in increasing order, after any items equal to it.
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+void IntrusiveSortedList<T, Link>::Insert(T *item)
+{
+    T *ptr;
+
+    // look for the first item in the list bigger than "item"
+    for (ptr = this->first; ptr != NULL; ptr = (ptr->*Link).next) {
+	if (compare(item, ptr) < 0) {
+	    break;
+	}
+    }
+    this->InsertBefore(item, ptr);
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::SanityCheck
+//      Test whether this is still a legal list.
+//
+//	Tests: do the forward and backward links agree?
+//	       does every item know it is on this list?
+//	       does the list have the right # of elements?
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+void IntrusiveList<T, Link>::SanityCheck() const
+{
+    T *prev = NULL, *ptr;
+    unsigned int numFound = 0;
+
+    for (ptr = first; ptr != NULL; prev = ptr, ptr = (ptr->*Link).next) {
+	numFound++;
+	ASSERT(numFound <= numInList);		// prevent infinite loop
+	ASSERT((ptr->*Link).prev == prev);
+	ASSERT((ptr->*Link).list == this);
+    }
+    ASSERT(last == prev);
+    ASSERT(numFound == numInList);
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::SelfTest
+//      Test whether this module is working.
+//
+//	"p" is an array of items that aren't on any list
+//	"numEntries" is the number of items in "p"
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+void IntrusiveList<T, Link>::SelfTest(T *p, int numEntries)
+{
+    int i;
+
+    SanityCheck();
+    ASSERT(IsEmpty() && (first == NULL));
+
+    for (i = 0; i < numEntries; i++) {
+	Append(&p[i]);
+	ASSERT(IsInList(&p[i]));
+	ASSERT(!IsEmpty());
+    }
+    SanityCheck();
+
+    // take one out of the middle, and put it back at the front
+    if (numEntries > 1) {
+	Remove(&p[numEntries / 2]);
+	ASSERT(!IsInList(&p[numEntries / 2]));
+	SanityCheck();
+	Prepend(&p[numEntries / 2]);
+	ASSERT(Front() == &p[numEntries / 2]);
+	SanityCheck();
+    }
+
+    // should be able to get out everything we put in
+    for (i = 0; i < numEntries; i++) {
+	Remove(&p[i]);
+	ASSERT(!IsInList(&p[i]));
+    }
+    ASSERT(IsEmpty());
+    SanityCheck();
+}
+
+//----------------------------------------------------------------------
+// IntrusiveSortedList<T, Link>::SanityCheck
+//      Test whether this is still a legal sorted list.
+//
+//	Test: is the list sorted?
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+void IntrusiveSortedList<T, Link>::SanityCheck() const
+{
+    T *ptr;
+
+    IntrusiveList<T, Link>::SanityCheck();
+    for (ptr = this->first; ptr != NULL && (ptr->*Link).next != NULL;
+					ptr = (ptr->*Link).next) {
+	ASSERT(compare(ptr, (ptr->*Link).next) <= 0);
+    }
+}
+
+//----------------------------------------------------------------------
+// IntrusiveSortedList<T, Link>::SelfTest
+//      Test whether this module is working.
+//----------------------------------------------------------------------
+
+template <class T, IntrusiveLink<T> T::*Link>
+void IntrusiveSortedList<T, Link>::SelfTest(T *p, int numEntries)
+{
+    int i;
+    T *prev = NULL, *item;
+
+    IntrusiveList<T, Link>::SelfTest(p, numEntries);
+
+    for (i = 0; i < numEntries; i++) {
+	Insert(&p[i]);
+	ASSERT(this->IsInList(&p[i]));
+    }
+    SanityCheck();
+
+    // should come out in the right order
+    for (i = 0; i < numEntries; i++) {
+	item = this->RemoveFront();
+	ASSERT(!this->IsInList(item));
+	ASSERT(prev == NULL || compare(prev, item) <= 0);
+	prev = item;
+    }
+    ASSERT(this->IsEmpty());
+    SanityCheck();
+}
@@ -0,0 +1,147 @@
+// intrusivelist.h
+//	Data structures to manage doubly linked lists of objects that
+//	carry their own links.
+//
+//	A List (see list.h) allocates a ListElement for every item put
+//	on it, and frees it when the item is taken off.  That is too
+//	expensive for lists that are updated on every context switch,
+//	such as the scheduler's ready queues.  Instead, an object that
+//	is to go on an IntrusiveList has an IntrusiveLink as one of its
+//	members, and the list threads its items together through that
+//	member; nothing is ever allocated.
+//
+//	The price is that an object can only be on as many lists at once
+//	as it has links -- and is on at most one list per link.  In
+//	return, finding out whether an item is on a list, and removing
+//	it, take constant time.
+//
+//	Allocation and deallocation of the items on the list are to be
+//	done by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef INTRUSIVELIST_H
+#define INTRUSIVELIST_H
+
+#include "copyright.h"
+#include "debug.h"
+
+// The following class defines the links an object needs to be on an
+// IntrusiveList.  Only the list touches these.
+
+template <class T>
+class IntrusiveLink {
+  public:
+    IntrusiveLink() { next = prev = NULL; list = NULL; }
+				// not on any list, to start with
+
+    T *next;			// next item on the list, NULL if last
+    T *prev;			// previous item, NULL if first
+    void *list;			// the list we are on, or NULL
+};
+
+// The following class defines an intrusive list of T's, linked through
+// the member "Link" of each T.  For example, with
+//
+//	class Thread { ... IntrusiveLink<Thread> queueLink; ... };
+//
+// an IntrusiveList<Thread, &Thread::queueLink> is a list of threads.
+
+template <class T, IntrusiveLink<T> T::*Link>
+class IntrusiveList {
+  public:
+    IntrusiveList();		// initialize the list
+    virtual ~IntrusiveList();	// de-allocate the list
+
+    void Prepend(T *item);	// Put item at the beginning of the list
+    void Append(T *item); 	// Put item at the end of the list
+
+    T *Front() { return first; }
+    				// Return first item on list, or NULL
+				// without removing it
+    T *RemoveFront(); 		// Take item off the front of the list
+    void Remove(T *item); 	// Remove specific item from list
+
+    bool IsInList(T *item) const { return ((item->*Link).list == this); }
+				// is the item in the list?
+
+    unsigned int NumInList() { return numInList;};
+    				// how many items in the list?
+    bool IsEmpty() { return (numInList == 0); };
+    				// is the list empty?
+
+    void Apply(void (*f)(T *)) const;
+    				// apply function to all elements in list
+
+    T *Next(T *item) const { return (item->*Link).next; }
+				// the item after "item", or NULL
+
+    void SanityCheck() const;
+				// has this list been corrupted?
+    void SelfTest(T *p, int numEntries);
+				// verify module is working
+
+  protected:
+    T *first;  		// Head of the list, NULL if list is empty
+    T *last;			// Last element of list
+    unsigned int numInList;	// number of elements in list
+
+    void InsertBefore(T *item, T *next);
+				// put "item" in front of "next"
+};
+
+// The following class defines a sorted intrusive list, kept in
+// increasing order according to "compare" (which returns -1, 0 or 1,
+// like the compare function of a SortedList).  Items that compare
+// equal stay in the order they were inserted.
+
+template <class T, IntrusiveLink<T> T::*Link>
+class IntrusiveSortedList : public IntrusiveList<T, Link> {
+  public:
+    IntrusiveSortedList(int (*comp)(T *x, T *y)) : IntrusiveList<T, Link>()
+	{ compare = comp; }
+
+    void Insert(T *item); 	// insert an item onto the list in sorted order
+
+    void SanityCheck() const;	// has this list been corrupted?
+    void SelfTest(T *p, int numEntries);
+				// verify module is working
+
+  private:
+    int (*compare)(T *x, T *y);	// function for sorting list elements
+
+    void Prepend(T *item) { Insert(item); }  // *pre*pending has no meaning
+				             //	in a sorted list
+    void Append(T *item) { Insert(item); }   // neither does *ap*pend
+};
+
+// The following class can be used to step through an intrusive list,
+// just like a ListIterator.  The current item may be removed from the
+// list only after moving on to the next one.
+
+template <class T, IntrusiveLink<T> T::*Link>
+class IntrusiveListIterator {
+  public:
+    IntrusiveListIterator(IntrusiveList<T, Link> *list)
+	{ current = list->Front(); }
+				// initialize an iterator
+
+    bool IsDone() { return current == NULL; };
+				// return TRUE if we are at the end of the list
+
+    T *Item() { ASSERT(!IsDone()); return current; };
+				// return current element on list
+
+    void Next() { current = (current->*Link).next; };
+				// update iterator to point to next
+
+  private:
+    T *current;			// where we are in the list
+};
+
+#include "intrusivelist.cc"	// templates are really like macros
+				// so needs to be included in every
+				// file that uses the template
+#endif // INTRUSIVELIST_H
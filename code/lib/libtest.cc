@@ -1,6 +1,7 @@
 // libtest.cc 
 //	Driver code to call self-test routines for standard library
-//	classes -- bitmaps, lists, sorted lists, and hash tables.
+//	classes -- bitmaps, lists, sorted lists, intrusive lists, and
+//	hash tables.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -10,6 +11,7 @@
 #include "libtest.h"
 #include "bitmap.h"
 #include "list.h"
+#include "intrusivelist.h"
 #include "hash.h"
 #include "sysdep.h"
 
@@ -53,6 +55,30 @@ HashKey(char *str) {
 // Array of values to be inserted into a List or SortedList. 
 static int listTestVector[] = { 9, 5, 7 };
 
+// Items to be put on an IntrusiveList or IntrusiveSortedList; each
+// carries the link the list threads through.
+class LinkedInt {
+  public:
+    LinkedInt(int v) { value = v; }
+
+    int value;
+    IntrusiveLink<LinkedInt> link;
+};
+
+//----------------------------------------------------------------------
+// LinkedIntCompare
+//	Compare the values of two LinkedInts, for testing
+//	IntrusiveSortedLists.
+//----------------------------------------------------------------------
+
+static int
+LinkedIntCompare(LinkedInt *x, LinkedInt *y) {
+    return IntCompare(x->value, y->value);
+}
+
+static LinkedInt linkedTestVector[] = { LinkedInt(9), LinkedInt(5),
+	LinkedInt(7), LinkedInt(5) };
+
 // Array of values to be inserted into the HashTable
 // There are enough here to force a ReHash().
 static char *hashTestVector[] = { "0", "1", "2", "3", "4", "5", "6",
@@ -60,8 +86,8 @@ static char *hashTestVector[] = { "0", "1", "2", "3", "4", "5", "6",
 
 //----------------------------------------------------------------------
 // LibSelfTest
-//	Run self tests on bitmaps, lists, sorted lists, and 
-//	hash tables.
+//	Run self tests on bitmaps, lists, sorted lists, intrusive
+//	lists, and hash tables.
 //----------------------------------------------------------------------
 
 void
@@ -69,6 +95,10 @@ LibSelfTest () {
     Bitmap *map = new Bitmap(200);
     List<int> *list = new List<int>;
     SortedList<int> *sortList = new SortedList<int>(IntCompare);
+    IntrusiveList<LinkedInt, &LinkedInt::link> *linkedList =
+	new IntrusiveList<LinkedInt, &LinkedInt::link>;
+    IntrusiveSortedList<LinkedInt, &LinkedInt::link> *sortLinkedList =
+	new IntrusiveSortedList<LinkedInt, &LinkedInt::link>(LinkedIntCompare);
     HashTable<int, char *> *hashTable = 
 	new HashTable<int, char *>(HashKey, HashInt);
 	
@@ -76,10 +106,16 @@ LibSelfTest () {
     map->SelfTest();
     list->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
     sortList->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
+    linkedList->SelfTest(linkedTestVector,
+			sizeof(linkedTestVector)/sizeof(LinkedInt));
+    sortLinkedList->SelfTest(linkedTestVector,
+			sizeof(linkedTestVector)/sizeof(LinkedInt));
     hashTable->SelfTest(hashTestVector, sizeof(hashTestVector)/sizeof(char *));
 
     delete map;
     delete list;
     delete sortList;
+    delete linkedList;
+    delete sortLinkedList;
     delete hashTable;
 }
@@ -30,9 +30,11 @@
 #include <unistd.h>
 #include <sys/time.h>
 #include <sys/file.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <cerrno>
+#include <time.h>
 
 #ifdef SOLARIS
 // KMS
@@ -426,6 +428,47 @@ Unlink(char *name)
     return unlink(name);
 }
 
+//----------------------------------------------------------------------
+// GetFileStamp
+// 	Report when a file was last modified, in seconds (and
+//	nanoseconds) since the epoch, and how big it is.  If the file
+//	does not exist, the stamp's time is -1.
+//
+//	"name" is the file's name
+//	"stamp" is where to put the answer
+//----------------------------------------------------------------------
+
+void
+GetFileStamp(char *name, FileStamp *stamp)
+{
+    struct stat info;
+
+    stamp->seconds = -1;
+    stamp->nanoseconds = 0;
+    stamp->size = 0;
+    if (stat(name, &info) < 0) {
+	return;
+    }
+    stamp->seconds = (long) info.st_mtime;
+#ifdef __APPLE__
+    stamp->nanoseconds = (long) info.st_mtimespec.tv_nsec;
+#else
+    stamp->nanoseconds = (long) info.st_mtim.tv_nsec;
+#endif
+    stamp->size = (long) info.st_size;
+}
+
+//----------------------------------------------------------------------
+// HostCPUTime
+// 	Return the processor time used by Nachos so far, in seconds.
+//----------------------------------------------------------------------
+
+double
+HostCPUTime()
+{
+    return (double) clock() / CLOCKS_PER_SEC;
+}
+
 //----------------------------------------------------------------------
 // OpenSocket
 // 	Open an interprocess communication (IPC) connection.  For now, 
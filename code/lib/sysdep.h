@@ -53,6 +53,27 @@ extern int Tell(int fd);
 extern int Close(int fd);
 extern bool Unlink(char *name);
 
+// Identifies one version of a file: when it was last modified (to the
+// nanosecond, where the host keeps track), and how big it was.  Two
+// stamps that differ in either mean the file has changed -- even if it
+// was rewritten within the same second.
+class FileStamp {
+  public:
+    long seconds;		// modification time; -1 if no such file
+    long nanoseconds;		// ... and the fraction of a second
+    long size;			// size in bytes
+
+    bool Equals(FileStamp *other) {
+	return (seconds == other->seconds
+		&& nanoseconds == other->nanoseconds && size == other->size); }
+};
+extern void GetFileStamp(char *name, FileStamp *stamp);
+
+// How much processor time (in seconds) the Nachos process itself has
+// used, for measuring how fast Nachos runs, as opposed to the
+// simulated machine
+extern double HostCPUTime();
+
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
 extern "C" {
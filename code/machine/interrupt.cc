@@ -154,9 +154,11 @@ Interrupt::OneTick()
     if (status == SystemMode) {
         stats->totalTicks += SystemTick;
 	stats->systemTicks += SystemTick;
+	kernel->currentThread->account.systemTicks += SystemTick;
     } else {
 	stats->totalTicks += UserTick;
 	stats->userTicks += UserTick;
+	kernel->currentThread->account.userTicks += UserTick;
     }
     DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
 
@@ -165,12 +167,20 @@ Interrupt::OneTick()
 				// (interrupt handlers run with
 				// interrupts disabled)
     CheckIfDue(FALSE);		// check for pending interrupts
+    if (oldStatus == UserMode) {
+	kernel->machine->CheckInstrSlice();	// time-slicing by
+						// instructions?
+    }
     ChangeLevel(IntOff, IntOn);	// re-enable interrupts
     if (yieldOnReturn) {	// if the timer device handler asked 
     				// for a context switch, ok to do it now
+	Thread *thread = kernel->currentThread;
+
 	yieldOnReturn = FALSE;
  	status = SystemMode;		// yield is a kernel routine
-	kernel->currentThread->Yield();
+	thread->preempted = TRUE;	// it didn't ask to (see
+	thread->Yield();		// Scheduler::Run)
+	thread->preempted = FALSE;
 	status = oldStatus;
     }
 }
@@ -193,6 +203,21 @@ Interrupt::YieldOnReturn()
     yieldOnReturn = TRUE; 
 }
 
+//----------------------------------------------------------------------
+// Interrupt::YieldSoon
+// 	Like YieldOnReturn, but may also be called outside an interrupt
+//	handler (for example, by the scheduler when a more important
+//	thread becomes ready).  The current thread Yields the next time
+//	simulated time advances: when interrupts are re-enabled, or
+//	after the next user instruction.
+//----------------------------------------------------------------------
+
+void
+Interrupt::YieldSoon()
+{ 
+    yieldOnReturn = TRUE; 
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Idle
 // 	Routine called when there is nothing in the ready queue.
@@ -235,6 +260,7 @@ Interrupt::Halt()
 {
     cout << "Machine halting!\n\n";
     cout << "This is halt\n";
+    kernel->scheduler->RecordThreads();
     kernel->stats->Print();
     delete kernel;	// Never returns.
 }
@@ -99,6 +99,8 @@ class Interrupt {
  
     void YieldOnReturn();	// cause a context switch on return 
 				// from an interrupt handler
+    void YieldSoon();		// cause a context switch the next
+				// time simulated time advances
 
     MachineStatus getStatus() { return status; } 
     void setStatus(MachineStatus st) { status = st; }
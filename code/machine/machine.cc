@@ -50,14 +50,25 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"instrsPerSlice" -- if not 0, time-slice threads running user
+//		programs every so many user instructions (see Machine::Run),
+//		instead of by the timer.
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, int instrsPerSlice)
 {
     int i;
 
-    for (i = 0; i < NumTotalRegs; i++)
-        registers[i] = 0;
+    for (i = 0; i < MaxCPUs; i++) {
+	for (int j = 0; j < NumTotalRegs; j++)
+	    registerFiles[i][j] = 0;
+	cpuRegisterOwner[i] = NULL;
+	cpuPageTable[i] = NULL;
+	cpuPageTableSize[i] = 0;
+	cpuPageTableOwner[i] = NULL;
+    }
+    cpu = 0;
+    registers = registerFiles[cpu];
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
@@ -71,7 +82,12 @@ Machine::Machine(bool debug)
     pageTable = NULL;
 #endif
 
+    registerOwner = NULL;
+    pageTableOwner = NULL;
+    pageTableSize = 0;
+
     singleStep = debug;
+    instrSlice = instrsPerSlice;
     CheckEndian();
 }
 
@@ -205,6 +221,100 @@ Machine::DumpState()
     cout << "\tLoadV:\t" << registers[LoadValueReg] << "\n";
 }
 
+//----------------------------------------------------------------------
+// Machine::SelectCPU
+//   	Make CPU "which" the one that executes user code from now on:
+//	its registers and page table become the machine's.  The state of
+//	the CPU that was selected is put aside, untouched, for when it
+//	is selected again.
+//
+//	This is how the CPUs share the one host thread: only the
+//	selected CPU runs, until the scheduler dispatches a thread on
+//	another.  Interrupts being off is therefore still all the
+//	mutual exclusion the kernel needs.
+//----------------------------------------------------------------------
+
+void
+Machine::SelectCPU(int which)
+{
+    ASSERT((which >= 0) && (which < MaxCPUs));
+    if (which == cpu) {
+	return;
+    }
+    cpuRegisterOwner[cpu] = registerOwner;
+    cpuPageTable[cpu] = pageTable;
+    cpuPageTableSize[cpu] = pageTableSize;
+    cpuPageTableOwner[cpu] = pageTableOwner;
+
+    cpu = which;
+    registers = registerFiles[cpu];
+    registerOwner = cpuRegisterOwner[cpu];
+    pageTable = cpuPageTable[cpu];
+    pageTableSize = cpuPageTableSize[cpu];
+    pageTableOwner = cpuPageTableOwner[cpu];
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchRegisters
+//   	A thread is about to run on the selected CPU, but its user
+//	registers may have been left behind on the one it ran on last
+//	(see Thread::RestoreUserState).  If so, copy them out, and free
+//	that CPU's register file.
+//
+//	Returns TRUE if the registers were found on another CPU.
+//
+//	"thread" is the thread about to run
+//	"userRegisters" is where to put its registers
+//----------------------------------------------------------------------
+
+bool
+Machine::FetchRegisters(Thread *thread, int *userRegisters)
+{
+    for (int i = 0; i < MaxCPUs; i++) {
+	if (i != cpu && cpuRegisterOwner[i] == thread) {
+	    for (int j = 0; j < NumTotalRegs; j++)
+		userRegisters[j] = registerFiles[i][j];
+	    cpuRegisterOwner[i] = NULL;
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Machine::Forget
+//   	A thread has finished, or an address space is being deleted;
+//	make sure no CPU still claims to hold its state.
+//----------------------------------------------------------------------
+
+void
+Machine::Forget(Thread *thread)
+{
+    if (registerOwner == thread) {
+	registerOwner = NULL;
+    }
+    for (int i = 0; i < MaxCPUs; i++) {
+	if (cpuRegisterOwner[i] == thread) {
+	    cpuRegisterOwner[i] = NULL;
+	}
+    }
+}
+
+void
+Machine::Forget(AddrSpace *space)
+{
+    if (pageTableOwner == space) {
+	pageTable = NULL;		// don't leave it dangling
+	pageTableOwner = NULL;
+    }
+    for (int i = 0; i < MaxCPUs; i++) {
+	if (cpuPageTableOwner[i] == space) {
+	    cpuPageTable[i] = NULL;
+	    cpuPageTableOwner[i] = NULL;
+	}
+    }
+}
+
 //----------------------------------------------------------------------
 // Machine::ReadRegister/WriteRegister
 //   	Fetch or write the contents of a user program register.
@@ -40,6 +40,8 @@ const int NumPhysPages = 128;
 const int MemorySize = (NumPhysPages * PageSize);
 const int TLBSize = 4;			// if there is a TLB, make it small
 
+const int MaxCPUs = 8;			// most simulated CPUs (see "-cpus")
+
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
 		     PageFaultException,    // No valid translation found
@@ -92,15 +94,20 @@ enum ExceptionType { NoException,           // Everything ok!
 
 class Instruction;
 class Interrupt;
+class Thread;
+class AddrSpace;
 
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
+    Machine(bool debug, int instrsPerSlice);
+				// Initialize the simulation of the hardware
 				// for running user programs
     ~Machine();			// De-allocate the data structures
 
 // Routines callable by the Nachos kernel
     void Run();	 		// Run a user program
+    void CheckInstrSlice();	// is the running thread's
+				// instruction slice up?
 
     int ReadRegister(int num);	// read the contents of a CPU register
 
@@ -140,6 +147,38 @@ class Machine {
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
 
+// The user registers and the page table stay in the machine when a user
+// program is switched out, until another program needs them; these say
+// whose they are, so that switching back can skip reloading them (see
+// Thread::RestoreUserState and AddrSpace::RestoreState).
+
+    Thread *registerOwner;		// thread whose user registers are
+					// in the machine, or NULL
+    AddrSpace *pageTableOwner;		// address space whose page table
+					// is loaded, or NULL
+
+// The machine may have several CPUs, which take turns executing (see
+// scheduler.h) -- on the one host thread, never in parallel: none of
+// the simulation is safe to run on more than one.  Each has its own
+// register file and page table register; the fields above, and the
+// registers, are those of the CPU selected by SelectCPU.
+
+    int InstrSlice() { return instrSlice; }
+					// user instructions per time
+					// slice; 0 if the timer slices
+
+    void SelectCPU(int which);		// switch to the registers and
+					// page table of CPU "which"
+    int CurrentCPU() { return cpu; }
+    bool FetchRegisters(Thread *thread, int *userRegisters);
+					// if "thread"'s registers are on
+					// another CPU, move them to
+					// "userRegisters"
+    void Forget(Thread *thread);	// no CPU holds "thread"'s
+					// registers any more
+    void Forget(AddrSpace *space);	// no CPU uses "space"'s page
+					// table any more
+
     bool ReadMem(int addr, int size, int* value);
     bool WriteMem(int addr, int size, int value);
     				// Read or write 1, 2, or 4 bytes of virtual 
@@ -173,12 +212,25 @@ class Machine {
 
 // Internal data structures
 
-    int registers[NumTotalRegs]; // CPU registers, for executing user programs
+    int *registers;		// CPU registers, for executing user programs
+				// (those of the selected CPU)
+    int registerFiles[MaxCPUs][NumTotalRegs];
+				// every CPU's registers
+    int cpu;			// the selected CPU
+    Thread *cpuRegisterOwner[MaxCPUs];
+    TranslationEntry *cpuPageTable[MaxCPUs];
+    unsigned int cpuPageTableSize[MaxCPUs];
+    AddrSpace *cpuPageTableOwner[MaxCPUs];
+				// state of the CPUs that aren't
+				// selected (see the public fields)
 
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
+    int instrSlice;		// user instructions a thread may run
+				// before its time slice is up; 0 if
+				// the timer slices time instead
 
     friend class Interrupt;		// calls DelayedLoad()    
 };
@@ -51,6 +51,13 @@ class Instruction {
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
+//
+//	If the machine slices time by instructions (see "-is"), the
+//	running thread's time slice is up once it has executed that
+//	many instructions since it was dispatched (see CheckInstrSlice);
+//	the scheduler then decides whether it should yield, just as it
+//	would on a timer interrupt.  How threads interleave then depends only on the
+//	instructions they run, not on how long the kernel takes.
 //----------------------------------------------------------------------
 
 void
@@ -66,6 +73,9 @@ Machine::Run()
     for (;;) {
 		// cout << "\n\ncall OneInstruction\n";
         OneInstruction(instr);
+	if (instrSlice > 0) {
+	    kernel->currentThread->userInstrs++;   // see CheckInstrSlice
+	}
 		kernel->interrupt->OneTick();
 		if (singleStep && (runUntilTime <= kernel->stats->totalTicks)){
 	  		// cout << "call Debugger\n"; 
@@ -74,6 +84,31 @@ Machine::Run()
     }
 }
 
+//----------------------------------------------------------------------
+// Machine::CheckInstrSlice
+// 	If the machine slices time by instructions, and the running
+//	thread has used up its slice, ask the scheduler whether it
+//	should yield; if so, it does at the end of this tick.
+//
+//	Called by Interrupt::OneTick after a user instruction, with
+//	interrupts already off, so that checking the slice does not
+//	itself advance simulated time.
+//----------------------------------------------------------------------
+
+void
+Machine::CheckInstrSlice()
+{
+    Thread *thread = kernel->currentThread;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    if (instrSlice > 0 && thread->userInstrs >= instrSlice) {
+	thread->userInstrs = 0;
+	if (kernel->scheduler->SliceExpired(thread)) {
+	    kernel->interrupt->YieldSoon();
+	}
+    }
+}
+
 
 //----------------------------------------------------------------------
 // TypeToReg
@@ -22,6 +22,280 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numStackHits = numStackMisses = numPooledStacks = 0;
+    shares = new List<ShareRecord *>;
+    deadlines = new List<DeadlineRecord *>;
+    cpus = new List<CPURecord *>;
+    quotas = new List<QuotaRecord *>;
+    synchs = new List<SynchRecord *>;
+}
+
+//----------------------------------------------------------------------
+// Statistics::~Statistics
+// 	De-allocate the per-thread records.
+//----------------------------------------------------------------------
+
+Statistics::~Statistics()
+{
+    while (!shares->IsEmpty()) {
+	delete shares->RemoveFront();
+    }
+    delete shares;
+    while (!deadlines->IsEmpty()) {
+	delete deadlines->RemoveFront();
+    }
+    delete deadlines;
+    while (!cpus->IsEmpty()) {
+	delete cpus->RemoveFront();
+    }
+    delete cpus;
+    while (!quotas->IsEmpty()) {
+	delete quotas->RemoveFront();
+    }
+    delete quotas;
+    while (!synchs->IsEmpty()) {
+	delete synchs->RemoveFront();
+    }
+    delete synchs;
+}
+
+//----------------------------------------------------------------------
+// ShareRecord::ShareRecord
+// 	Remember the CPU share of a thread.  The name is copied, since
+//	the thread (and its name) may go away before we print it.
+//----------------------------------------------------------------------
+
+ShareRecord::ShareRecord(char *threadName, int numTickets, int numTicks)
+{
+    name = new char[strlen(threadName) + 1];
+    strcpy(name, threadName);
+    tickets = numTickets;
+    ticks = numTicks;
+}
+
+ShareRecord::~ShareRecord()
+{
+    delete [] name;
+}
+
+//----------------------------------------------------------------------
+// DeadlineRecord::DeadlineRecord
+// 	Remember how a real-time thread fared.  The name is copied, as
+//	for a ShareRecord.
+//----------------------------------------------------------------------
+
+DeadlineRecord::DeadlineRecord(char *threadName, int numPeriods, 
+				int numMisses, int numOverruns)
+{
+    name = new char[strlen(threadName) + 1];
+    strcpy(name, threadName);
+    periods = numPeriods;
+    misses = numMisses;
+    overruns = numOverruns;
+}
+
+DeadlineRecord::~DeadlineRecord()
+{
+    delete [] name;
+}
+
+//----------------------------------------------------------------------
+// CPURecord::CPURecord
+// 	Remember how busy a CPU was.
+//----------------------------------------------------------------------
+
+CPURecord::CPURecord(int cpuID, int numBusyTicks, int numDispatches,
+			int numSteals, int numMigrations)
+{
+    id = cpuID;
+    busyTicks = numBusyTicks;
+    dispatches = numDispatches;
+    steals = numSteals;
+    migrations = numMigrations;
+}
+
+//----------------------------------------------------------------------
+// QuotaRecord::QuotaRecord
+// 	Remember how often a program's CPU quota throttled it.  The
+//	name is copied, as for a ShareRecord.
+//----------------------------------------------------------------------
+
+QuotaRecord::QuotaRecord(char *programName, int quotaPeriod,
+			int quotaBudget, int numThrottled, int numThrottledTicks)
+{
+    name = new char[strlen(programName) + 1];
+    strcpy(name, programName);
+    period = quotaPeriod;
+    budget = quotaBudget;
+    throttled = numThrottled;
+    throttledTicks = numThrottledTicks;
+}
+
+QuotaRecord::~QuotaRecord()
+{
+    delete [] name;
+}
+
+//----------------------------------------------------------------------
+// SynchRecord::SynchRecord
+// 	Start a contention record for synchronization objects of one
+//	kind, with one name.  The name is copied, as for a ShareRecord.
+//
+//	"objectKind" is a constant string, such as "lock"
+//----------------------------------------------------------------------
+
+SynchRecord::SynchRecord(char *objectKind, char *objectName)
+{
+    kind = objectKind;
+    name = new char[strlen(objectName) + 1];
+    strcpy(name, objectName);
+    acquires = contended = waitTicks = maxWait = 0;
+    releases = holdTicks = maxHold = 0;
+}
+
+SynchRecord::~SynchRecord()
+{
+    delete [] name;
+}
+
+//----------------------------------------------------------------------
+// SynchRecord::Acquired
+// 	Count an acquisition of one of the objects.
+//
+//	"waited" is TRUE if the thread had to wait for the object
+//	"ticks" is how long it waited
+//----------------------------------------------------------------------
+
+void
+SynchRecord::Acquired(bool waited, int ticks)
+{
+    acquires++;
+    if (waited) {
+	contended++;
+	waitTicks += ticks;
+	maxWait = max(maxWait, ticks);
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchRecord::Released
+// 	Count a release of one of the objects.
+//
+//	"ticks" is how long it was held
+//----------------------------------------------------------------------
+
+void
+SynchRecord::Released(int ticks)
+{
+    releases++;
+    holdTicks += ticks;
+    maxHold = max(maxHold, ticks);
+}
+
+//----------------------------------------------------------------------
+// Statistics::RecordShare
+// 	Record the CPU share of a thread, under proportional-share
+//	scheduling; printed at shutdown.
+//
+//	"name" is the thread's name
+//	"tickets" is the share it asked for
+//	"ticks" is the CPU time it got
+//----------------------------------------------------------------------
+
+void
+Statistics::RecordShare(char *name, int tickets, int ticks)
+{
+    shares->Append(new ShareRecord(name, tickets, ticks));
+}
+
+//----------------------------------------------------------------------
+// Statistics::RecordDeadlines
+// 	Record how many deadlines a real-time thread met; printed at
+//	shutdown.
+//
+//	"name" is the thread's name
+//	"periods" is the number of periods it went through
+//	"misses" is the number of periods that ended before it got
+//		its budget
+//	"overruns" is the number of periods in which it wanted more
+//		than its budget
+//----------------------------------------------------------------------
+
+void
+Statistics::RecordDeadlines(char *name, int periods, int misses, 
+				int overruns)
+{
+    deadlines->Append(new DeadlineRecord(name, periods, misses, overruns));
+}
+
+//----------------------------------------------------------------------
+// Statistics::RecordCPU
+// 	Record how busy a CPU was, on a machine with more than one;
+//	printed at shutdown.
+//
+//	"id" is the number of the CPU
+//	"busyTicks" is the time it spent running threads
+//	"dispatches" is the number of threads dispatched on it
+//	"steals" is the number of threads it took from other CPUs
+//	"migrations" is the number of threads that moved to it
+//----------------------------------------------------------------------
+
+void
+Statistics::RecordCPU(int id, int busyTicks, int dispatches, int steals,
+			int migrations)
+{
+    cpus->Append(new CPURecord(id, busyTicks, dispatches, steals,
+				migrations));
+}
+
+//----------------------------------------------------------------------
+// Statistics::RecordQuota
+// 	Record how often a user program's CPU quota throttled it;
+//	printed at shutdown.
+//
+//	"name" is the program's name
+//	"period" is the length of a quota period
+//	"budget" is the CPU ticks it could use every period
+//	"throttled" is the number of periods in which it was throttled
+//	"throttledTicks" is the time it spent throttled
+//----------------------------------------------------------------------
+
+void
+Statistics::RecordQuota(char *name, int period, int budget, int throttled,
+			int throttledTicks)
+{
+    quotas->Append(new QuotaRecord(name, period, budget, throttled,
+				throttledTicks));
+}
+
+//----------------------------------------------------------------------
+// Statistics::SynchRecordFor
+// 	Return the contention record for synchronization objects of a
+//	kind, with a name, starting one if there isn't one yet.  Called
+//	when such an object is created, and synchronization profiling
+//	is on; the object counts what happens to it in the record, and
+//	the records are printed at shutdown.  Objects with the same
+//	kind and name share a record.
+//
+//	"kind" is a constant string, such as "lock"
+//	"name" is the object's name
+//----------------------------------------------------------------------
+
+SynchRecord *
+Statistics::SynchRecordFor(char *kind, char *name)
+{
+    SynchRecord *rec;
+
+    for (ListIterator<SynchRecord *> iter(synchs); !iter.IsDone();
+							iter.Next()) {
+	rec = iter.Item();
+	if (strcmp(rec->kind, kind) == 0 && strcmp(rec->name, name) == 0) {
+	    return rec;
+	}
+    }
+    rec = new SynchRecord(kind, name);
+    synchs->Append(rec);
+    return rec;
 }
 
 //----------------------------------------------------------------------
@@ -42,4 +316,91 @@ Statistics::Print()
     cout << "Paging: faults " << numPageFaults << "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
+    cout << "Thread stacks: reused " << numStackHits << ", allocated "
+	<< numStackMisses << ", hit rate "
+	<< (numStackHits + numStackMisses == 0 ? 0 :
+		100 * numStackHits / (numStackHits + numStackMisses))
+	<< "%, pooled " << numPooledStacks << "\n";
+
+    if (!shares->IsEmpty()) {
+	ListIterator<ShareRecord *> sum(shares);
+	ListIterator<ShareRecord *> iter(shares);
+	double totalShareTickets = 0, totalShareTicks = 0;
+
+	for (; !sum.IsDone(); sum.Next()) {
+	    totalShareTickets += sum.Item()->tickets;
+	    totalShareTicks += sum.Item()->ticks;
+	}
+	cout << "CPU share (requested / achieved):\n";
+	for (; !iter.IsDone(); iter.Next()) {
+	    ShareRecord *rec = iter.Item();
+
+	    cout << "  " << rec->name << ": tickets " << rec->tickets
+		<< ", ticks " << rec->ticks << ", "
+		<< 100 * rec->tickets / totalShareTickets << "% / "
+		<< (totalShareTicks == 0 ? 0 : 100 * rec->ticks / totalShareTicks)
+		<< "%\n";
+	}
+    }
+
+    if (!deadlines->IsEmpty()) {
+	ListIterator<DeadlineRecord *> iter(deadlines);
+	int totalMisses = 0;
+
+	cout << "Real-time deadlines:\n";
+	for (; !iter.IsDone(); iter.Next()) {
+	    DeadlineRecord *rec = iter.Item();
+
+	    cout << "  " << rec->name << ": periods " << rec->periods
+		<< ", missed " << rec->misses << ", overran " 
+		<< rec->overruns << "\n";
+	    totalMisses += rec->misses;
+	}
+	cout << "Deadline misses: " << totalMisses << "\n";
+    }
+
+    if (!cpus->IsEmpty()) {
+	ListIterator<CPURecord *> iter(cpus);
+
+	cout << "CPUs:\n";
+	for (; !iter.IsDone(); iter.Next()) {
+	    CPURecord *rec = iter.Item();
+
+	    cout << "  cpu " << rec->id << ": busy " << rec->busyTicks
+		<< " ticks, dispatches " << rec->dispatches << ", steals "
+		<< rec->steals << ", migrations " << rec->migrations << "\n";
+	}
+    }
+
+    if (!quotas->IsEmpty()) {
+	ListIterator<QuotaRecord *> iter(quotas);
+
+	cout << "CPU quotas:\n";
+	for (; !iter.IsDone(); iter.Next()) {
+	    QuotaRecord *rec = iter.Item();
+
+	    cout << "  " << rec->name << ": " << rec->budget << " ticks every "
+		<< rec->period << ", throttled " << rec->throttled
+		<< " times, for " << rec->throttledTicks << " ticks\n";
+	}
+    }
+
+    if (!synchs->IsEmpty()) {
+	ListIterator<SynchRecord *> iter(synchs);
+
+	cout << "Synchronization (wait and hold times in ticks):\n";
+	for (; !iter.IsDone(); iter.Next()) {
+	    SynchRecord *rec = iter.Item();
+
+	    cout << "  " << rec->kind << " " << rec->name << ": acquired "
+		<< rec->acquires << ", contended " << rec->contended
+		<< ", waited " << rec->waitTicks << " (max " << rec->maxWait
+		<< ")";
+	    if (rec->releases > 0) {
+		cout << ", held " << rec->holdTicks << " (max "
+		    << rec->maxHold << ")";
+	    }
+	    cout << "\n";
+	}
+    }
 }
@@ -12,6 +12,87 @@
 #define STATS_H
 
 #include "copyright.h"
+#include "list.h"
+
+// CPU share of one thread, under proportional-share scheduling.
+
+class ShareRecord {
+  public:
+    ShareRecord(char *threadName, int numTickets, int numTicks);
+    ~ShareRecord();
+
+    char *name;			// the thread's name (our own copy)
+    int tickets;		// share it asked for
+    int ticks;			// CPU time it got
+};
+
+// Deadline record of one real-time thread.
+
+class DeadlineRecord {
+  public:
+    DeadlineRecord(char *threadName, int numPeriods, int numMisses,
+			int numOverruns);
+    ~DeadlineRecord();
+
+    char *name;			// the thread's name (our own copy)
+    int periods;		// # of periods it has been through
+    int misses;			// # of deadlines it missed
+    int overruns;		// # of periods it overran its budget
+};
+
+// How busy one CPU was, on a machine with more than one.
+
+class CPURecord {
+  public:
+    CPURecord(int cpuID, int numBusyTicks, int numDispatches,
+			int numSteals, int numMigrations);
+
+    int id;			// which CPU
+    int busyTicks;		// ticks it spent running threads
+    int dispatches;		// # of threads dispatched on it
+    int steals;			// # of threads it stole from others
+    int migrations;		// # of threads that moved to it
+};
+
+// How often one user program's CPU quota throttled it.
+
+class QuotaRecord {
+  public:
+    QuotaRecord(char *programName, int quotaPeriod, int quotaBudget,
+			int numThrottled, int numThrottledTicks);
+    ~QuotaRecord();
+
+    char *name;			// the program's name (our own copy)
+    int period;			// length of a quota period
+    int budget;			// ticks it could use every period
+    int throttled;		// # of periods in which it was throttled
+    int throttledTicks;		// time it spent throttled
+};
+
+// Contention record of the synchronization objects of one kind with
+// one name (a Lock, say, or all the per-thread semaphores called
+// "exited"), kept only when synchronization profiling is on.
+
+class SynchRecord {
+  public:
+    SynchRecord(char *objectKind, char *objectName);
+    ~SynchRecord();
+
+    void Acquired(bool waited, int ticks);
+				// the object was acquired after
+				// waiting "ticks" (if "waited")
+    void Released(int ticks);	// it was held for "ticks"
+
+    char *kind;			// "semaphore", "lock" or "condition"
+    char *name;			// the objects' name (our own copy)
+    int acquires;		// # of times acquired
+    int contended;		// # of those that had to wait
+    int waitTicks;		// total time spent waiting
+    int maxWait;		// longest wait
+    int releases;		// # of times released (locks only)
+    int holdTicks;		// total time held
+    int maxHold;		// longest time held
+};
 
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
@@ -35,10 +116,37 @@ class Statistics {
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numStackHits;		// thread stacks reused from the pool
+    int numStackMisses;		// thread stacks that had to be allocated
+    int numPooledStacks;	// unused stacks in the pool right now
 
     Statistics(); 		// initialize everything to zero
+    ~Statistics();
 
+    void RecordShare(char *name, int tickets, int ticks);
+				// a thread with "tickets" got "ticks"
+				// of CPU time
+    void RecordDeadlines(char *name, int periods, int misses,
+				int overruns);
+				// a real-time thread's deadline record
+    void RecordCPU(int id, int busyTicks, int dispatches, int steals,
+				int migrations);
+				// how busy a CPU was
+    void RecordQuota(char *name, int period, int budget, int throttled,
+				int throttledTicks);
+				// how often a program was throttled
+    SynchRecord *SynchRecordFor(char *kind, char *name);
+				// the contention record for objects
+				// of "kind" named "name"
     void Print();		// print collected statistics
+
+  private:
+    List<ShareRecord *> *shares;// per-thread CPU shares, if any
+    List<DeadlineRecord *> *deadlines;
+				// per-thread deadline records, if any
+    List<CPURecord *> *cpus;	// per-CPU records, if more than one
+    List<QuotaRecord *> *quotas;// per-program CPU quota records
+    List<SynchRecord *> *synchs;// contention records, if profiling
 };
 
 // Constants used to reflect the relative time an operation would
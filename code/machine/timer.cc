@@ -5,11 +5,17 @@
 //      This means it can be used for implementing time-slicing.
 //
 //      We emulate a hardware timer by scheduling an interrupt to occur
-//      every time stats->totalTicks has increased by TimerTicks.
+//      when stats->totalTicks reaches the time the timer was armed for.
 //
 //      In order to introduce some randomness into time-slicing, if "doRandom"
 //      is set, then the interrupt is comes after a random number of ticks.
 //
+//	Interrupts that have been scheduled can't be taken back, so when
+//	the timer is re-programmed to go off later than an interrupt
+//	that is already scheduled (or disarmed), that interrupt is simply
+//	ignored when it happens (and we make sure there will be one at
+//	the new time, if any).
+//
 //	Remember -- nothing in here is part of Nachos.  It is just
 //	an emulation for the hardware that Nachos is running on top of.
 //
@@ -27,55 +33,118 @@
 //----------------------------------------------------------------------
 // Timer::Timer
 //      Initialize a hardware timer device.  Save the place to call
-//	on each interrupt, and then arrange for the timer to start
-//	generating interrupts.
+//	on each interrupt.  The timer doesn't go off until it is armed.
 //
 //      "doRandom" -- if true, arrange for the interrupts to occur
 //		at random, instead of fixed, intervals.
 //      "toCall" is the interrupt handler to call when the timer expires.
 //----------------------------------------------------------------------
 
+//----------------------------------------------------------------------
+// TimeCompare
+//	Compare two times, to keep the scheduled interrupts in order.
+//----------------------------------------------------------------------
+
+static int
+TimeCompare(int x, int y)
+{
+    if (x < y) { return -1; }
+    else if (x > y) { return 1; }
+    else { return 0; }
+}
+
 Timer::Timer(bool doRandom, CallBackObj *toCall)
 {
     randomize = doRandom;
     callPeriodically = toCall;
     disable = FALSE;
-    SetInterrupt();
+    expiry = -1;
+    pending = new SortedList<int>(TimeCompare);
 }
 
 //----------------------------------------------------------------------
 // Timer::CallBack
 //      Routine called when interrupt is generated by the hardware 
-//	timer device.  Schedule the next interrupt, and invoke the
-//	interrupt handler.
+//	timer device.  If the timer has been re-programmed to go off
+//	later, or disarmed, ignore it.  Otherwise, invoke the interrupt
+//	handler, which may arm the timer again.
 //----------------------------------------------------------------------
 void 
 Timer::CallBack() 
 {
+    int now = kernel->stats->totalTicks;
+
+    ASSERT(!pending->IsEmpty() && pending->Front() <= now);
+    (void) pending->RemoveFront();
+    if (disable || expiry < 0) {
+	return;			// not wanted at all
+    }
+    if (now < expiry) {		// we've been re-programmed to go off
+	SetInterrupt(expiry);	// later
+	return;
+    }
+
     // invoke the Nachos interrupt handler for this device
+    expiry = -1;		// one-shot
     callPeriodically->CallBack();
-    
-    SetInterrupt();	// do last, to let software interrupt handler
-    			// decide if it wants to disable future interrupts
+}
+
+//----------------------------------------------------------------------
+// Timer::Arm
+//      Program the timer to go off "delay" ticks from now, or after
+//	a random delay, instead of when it was going to.
+//
+//	"delay" is how long until the next interrupt
+//----------------------------------------------------------------------
+
+void
+Timer::Arm(int delay) 
+{
+    ASSERT(delay > 0);
+    if (randomize) {
+	delay = 1 + (RandomNumber() % (delay * 2));
+    }
+    expiry = kernel->stats->totalTicks + delay;
+    SetInterrupt(expiry);
+}
+
+//----------------------------------------------------------------------
+// Timer::ArmBy
+//      Make sure the timer goes off no more than "delay" ticks from
+//	now; if it was going to go off sooner than that, leave it be.
+//
+//	"delay" is the longest we may wait for the next interrupt
+//----------------------------------------------------------------------
+
+void
+Timer::ArmBy(int delay) 
+{
+    int when = kernel->stats->totalTicks + delay;
+
+    ASSERT(delay > 0);
+    if (expiry < 0 || when < expiry) {
+	expiry = when;
+	SetInterrupt(expiry);
+    }
 }
 
 //----------------------------------------------------------------------
 // Timer::SetInterrupt
-//      Cause a timer interrupt to occur in the future, unless
-//	future interrupts have been disabled.  The delay is either
-//	fixed or random.
+//      Make sure a timer interrupt occurs at a given time, unless
+//	future interrupts have been disabled.  If one is already
+//	scheduled before then, we'll schedule another one when that
+//	happens.
+//
+//	"when" is the time at which the handler should be called
 //----------------------------------------------------------------------
 
 void
-Timer::SetInterrupt() 
+Timer::SetInterrupt(int when) 
 {
-    if (!disable) {
-       int delay = TimerTicks;
-    
-       if (randomize) {
-	     delay = 1 + (RandomNumber() % (TimerTicks * 2));
-        }
+    if (!disable && (pending->IsEmpty() || pending->Front() > when)) {
        // schedule the next timer device interrupt
-       kernel->interrupt->Schedule(this, delay, TimerInt);
+       kernel->interrupt->Schedule(this, when - kernel->stats->totalTicks,
+								TimerInt);
+       pending->Insert(when);
     }
 }
@@ -8,8 +8,16 @@
 //	We emulate a hardware timer by scheduling an interrupt to occur
 //	every time stats->totalTicks has increased by TimerTicks.
 //
+//	Unlike the original Nachos timer, ours is one-shot: it goes off
+//	once each time it is programmed (Arm) to, a given number of
+//	ticks from now, and not at all if it isn't (or has been
+//	Disarm'ed since).  The kernel uses this to make interrupts come
+//	only when it next needs to make a decision -- and not at all
+//	while there is only one thread to run.
+//
 //	In order to introduce some randomness into time-slicing, if "doRandom"
-//	is set, then the interrupt comes after a random number of ticks.
+//	is set, then the interrupt comes after a random number of ticks
+//	(between 1 and twice the delay asked for).
 //
 //  DO NOT CHANGE -- part of the machine emulation
 //
@@ -23,6 +31,7 @@
 #include "copyright.h"
 #include "utility.h"
 #include "callback.h"
+#include "list.h"
 
 // The following class defines a hardware timer. 
 class Timer : public CallBackObj {
@@ -30,24 +39,36 @@ class Timer : public CallBackObj {
     Timer(bool doRandom, CallBackObj *toCall);
 				// Initialize the timer, and callback to "toCall"
 				// every time slice.
-    virtual ~Timer() {}
+    virtual ~Timer() { delete pending; }
     
     void Disable() { disable = TRUE; }
     				// Turn timer device off, so it doesn't
 				// generate any more interrupts.
+    void Arm(int delay);	// Interrupt "delay" ticks from now
+				// (or a random delay), instead of
+				// whenever we were going to
+    void ArmBy(int delay);	// Make sure we interrupt no later than
+				// "delay" ticks from now
+    void Disarm() { expiry = -1; }
+				// Don't interrupt, until we are armed
+				// again
+    bool IsArmed() { return (expiry >= 0); }
 
   private:
     bool randomize;		// set if we need to use a random timeout delay
-    CallBackObj *callPeriodically; // call this every TimerTicks time units 
+    CallBackObj *callPeriodically; // call this when the timer goes off
     bool disable;		// turn off the timer device after next
     				// interrupt.
+    int expiry;			// when the handler is to be called next,
+				// or -1 if it isn't
+    SortedList<int> *pending;	// times of the interrupts we have
+				// scheduled, but which haven't happened
     
     void CallBack();		// called internally when the hardware
 				// timer generates an interrupt
 
-    void SetInterrupt();  	// cause an interrupt to occur in the
-    				// the future after a fixed or random
-				// delay
+    void SetInterrupt(int when);// make sure an interrupt occurs at
+    				// time "when"
 };
 
 #endif // TIMER_H
@@ -0,0 +1,24 @@
+/* exec_test1.c
+ *	Pass bad pointers to Exec and ExecV.  Each call should fail
+ *	with -1, rather than killing this program or the kernel, so
+ *	this prints -1 four times.
+ */
+
+#include "syscall.h"
+
+int
+main()
+{
+	char *badArgv[2];
+
+	PrintInt(Exec((char *) 0x7ffffff0));		/* name out of range */
+	PrintInt(ExecV(2, (char **) -8));		/* argv out of range */
+
+	badArgv[0] = "add";
+	badArgv[1] = (char *) 0x7ffffff0;		/* one bad argument */
+	PrintInt(ExecV(2, badArgv));
+
+	PrintInt(ExecV(1, (char **) ((int) badArgv + 2)));	/* argv
+								   misaligned */
+	return 0;
+}
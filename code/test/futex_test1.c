@@ -0,0 +1,158 @@
+/* futex_test1.c
+ *	Test FutexWait and FutexWake with user threads.
+ *
+ *	First, FutexWait returns 1 at once if the word no longer holds
+ *	the value, and -1 for an address that isn't word-aligned.
+ *
+ *	Then three threads go to sleep on the same word, one after the
+ *	other.  FutexWake(&gate, 2) wakes only two of them, the ones
+ *	that have waited longest; a second FutexWake wakes the last one.
+ *
+ *	Last, three threads add to a counter under a mutex made from
+ *	FutexWait and FutexWake, yielding in the middle of each update;
+ *	without the mutex, updates would be lost.  The simulated MIPS has
+ *	no atomic read-modify-write instruction, so the mutex decides who
+ *	goes next with Lamport's bakery algorithm, and threads sleep on a
+ *	futex, rather than spin, while someone else holds it.
+ *
+ *	Prints 1, -1, 2, 11, 12, 1, 13, 30.
+ */
+
+#include "syscall.h"
+
+#define NTHREADS 3
+#define NADDS 10
+
+int gate = 0;				/* the waiters sleep on this */
+int woken[NTHREADS];			/* waiter i has been woken */
+
+int choosing[NTHREADS];			/* the mutex: bakery tickets */
+int number[NTHREADS];
+int counter = 0;			/* protected by the mutex */
+int done[NTHREADS];
+
+/* Sleep until the word at "addr" no longer holds "value". */
+void
+WaitWhile(int *addr, int value)
+{
+	while (*addr == value) {
+		(void) FutexWait(addr, value);
+	}
+}
+
+void
+Lock(int i)
+{
+	int j, n, max = 0;
+
+	choosing[i] = 1;
+	for (j = 0; j < NTHREADS; j++) {
+		if (number[j] > max) {
+			max = number[j];
+		}
+	}
+	number[i] = max + 1;
+	choosing[i] = 0;
+	(void) FutexWake(&choosing[i], NTHREADS);
+
+	for (j = 0; j < NTHREADS; j++) {
+		WaitWhile(&choosing[j], 1);
+		/* wait for the threads ahead of us to be done */
+		while ((n = number[j]) != 0
+				&& (n < number[i] || (n == number[i] && j < i))) {
+			(void) FutexWait(&number[j], n);
+		}
+	}
+}
+
+void
+Unlock(int i)
+{
+	number[i] = 0;
+	(void) FutexWake(&number[i], NTHREADS);
+}
+
+void
+waiter(int i)
+{
+	if (FutexWait(&gate, 0) == 0) {
+		PrintInt(11 + i);
+	}
+	woken[i] = 1;
+	ThreadExit(0);
+}
+
+void waiter0() { waiter(0); }
+void waiter1() { waiter(1); }
+void waiter2() { waiter(2); }
+
+void
+adder(int i)
+{
+	int k, tmp;
+
+	for (k = 0; k < NADDS; k++) {
+		Lock(i);
+		tmp = counter;
+		ThreadYield();		/* let the others try to get in */
+		counter = tmp + 1;
+		Unlock(i);
+	}
+	done[i] = 1;
+	ThreadExit(0);
+}
+
+void adder0() { adder(0); }
+void adder1() { adder(1); }
+void adder2() { adder(2); }
+
+/* Fork "func", and let it run until it is asleep in FutexWait. */
+void
+ForkWaiter(void (*func)())
+{
+	int i;
+
+	if (ThreadFork(func) < 0) {
+		PrintInt(-2);
+		Exit(1);
+	}
+	for (i = 0; i < 5; i++) {
+		ThreadYield();
+	}
+}
+
+int
+main()
+{
+	int i;
+
+	gate = 5;
+	PrintInt(FutexWait(&gate, 4));		/* 1: gate isn't 4 */
+	PrintInt(FutexWait((int *) 2, 0));	/* -1: not aligned */
+	gate = 0;
+
+	ForkWaiter(waiter0);
+	ForkWaiter(waiter1);
+	ForkWaiter(waiter2);
+	PrintInt(FutexWake(&gate, 2));		/* 2: wakes 0 and 1 */
+	while (!woken[0] || !woken[1]) {
+		ThreadYield();
+	}
+	PrintInt(FutexWake(&gate, 2));		/* 1: only 2 is left */
+	while (!woken[2]) {
+		ThreadYield();
+	}
+
+	if (ThreadFork(adder0) < 0 || ThreadFork(adder1) < 0
+			|| ThreadFork(adder2) < 0) {
+		PrintInt(-3);
+		Exit(1);
+	}
+	for (i = 0; i < NTHREADS; i++) {
+		while (!done[i]) {
+			ThreadYield();
+		}
+	}
+	PrintInt(counter);			/* 30 */
+	return 0;
+}
@@ -0,0 +1,69 @@
+/* thread_test1.c
+ *	Fork user threads with ThreadFork, and wait for them with
+ *	ThreadJoin.  One thread ends by calling ThreadExit, the other
+ *	by returning from its function; both exit codes should come
+ *	back through ThreadJoin.  A third thread outlives the main one:
+ *	Exit only ends the thread that calls it, and the program exits
+ *	(with status 0) once the third thread has called ThreadExit too.
+ *	Prints 3, 2, 1, 100, 200, 300, 400.
+ */
+
+#include "syscall.h"
+
+int count = 3;
+int mainDone = 0;
+
+void
+exiter()
+{
+	ThreadYield();			/* let the other thread run too */
+	ThreadExit(100);
+}
+
+int
+returner()
+{
+	while (count > 0) {
+		PrintInt(count);
+		count--;
+		ThreadYield();
+	}
+	return 200;			/* same as ThreadExit(200) */
+}
+
+void
+survivor()
+{
+	int i;
+
+	while (!mainDone) {
+		ThreadYield();
+	}
+	for (i = 0; i < 3; i++) {	/* let the main thread Exit */
+		ThreadYield();
+	}
+	PrintInt(400);			/* still running after Exit */
+	ThreadExit(1);			/* the program's status stays 0 */
+}
+
+int
+main()
+{
+	ThreadId a, b, c;
+
+	a = ThreadFork(exiter);
+	b = ThreadFork((void (*)()) returner);
+	c = ThreadFork(survivor);
+	if (a < 0 || b < 0 || c < 0) {
+		PrintInt(-1);
+		Exit(1);
+	}
+	while (count > 0) {		/* wait for returner to finish */
+		ThreadYield();
+	}
+	PrintInt(ThreadJoin(a));
+	PrintInt(ThreadJoin(b));
+	PrintInt(ThreadJoin(0) == -1 ? 300 : -1);	/* 0 is ourself */
+	mainDone = 1;
+	Exit(0);			/* survivor goes on running */
+}
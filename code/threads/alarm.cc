@@ -39,8 +39,23 @@ Alarm::Alarm(bool doRandom)
 //	if the interrupted thread called Yield at the point it is 
 //	was interrupted.
 //
-//	For now, just provide time-slicing.  Only need to time slice 
-//      if we're currently running something (in other words, not idle).
+//	When the machine slices time by user instructions instead (see
+//	Machine::Run), the timer doesn't preempt threads running user
+//	programs; it still starts new periods.
+//
+//	Real-time threads whose deadline has passed, and throttled
+//	programs whose quota period has ended, start a new period
+//	(even if we are idle, since that may make a throttled thread
+//	runnable again).  Then time-slice: only need to time slice 
+//      if we're currently running something (in other words, not idle),
+//	and the scheduler says the running thread's quantum is up.
+//
+//	The timer is one-shot.  It is set to go off again when the
+//	scheduler next needs to look at the running thread, which
+//	depends on its quantum -- or not at all, if preempting the
+//	thread couldn't change which one runs (see Scheduler::ArmTimer).
+//	If we are about to switch threads, Scheduler::Run sets it again,
+//	for the next thread.
 //----------------------------------------------------------------------
 
 void 
@@ -48,8 +63,14 @@ Alarm::CallBack()
 {
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
+    bool byInstrs = (kernel->machine->InstrSlice() > 0
+			&& kernel->currentThread->space != NULL);
     
-    if (status != IdleMode) {
+    kernel->scheduler->CheckDeadlines();
+    kernel->scheduler->CheckQuotas();
+    if (status != IdleMode && !byInstrs &&
+		kernel->scheduler->SliceExpired(kernel->currentThread)) {
 	interrupt->YieldOnReturn();
     }
+    kernel->scheduler->ArmTimer(kernel->currentThread);
 }
@@ -31,6 +31,16 @@ class Alarm : public CallBackObj {
     
     void WaitUntil(int x);	// suspend execution until time > now + x
                                 // this method is not yet implemented
+    void StartSlice(int ticks) { timer->Arm(ticks); }
+				// a thread has been dispatched; 
+				// interrupt once it has run "ticks"
+    void CutSlice(int ticks) { timer->ArmBy(ticks); }
+				// make sure we interrupt no more than
+				// "ticks" from now
+    void StopSlices() { timer->Disarm(); }
+				// don't interrupt the running thread
+    bool SliceRunning() { return timer->IsArmed(); }
+				// will we interrupt it?
 
   private:
     Timer *timer;		// the hardware timer device
@@ -17,6 +17,10 @@
 #include "synchdisk.h"
 #include "post.h"
 #include "synchconsole.h"
+#include "execcache.h"
+#include "threadpool.h"
+#include "proctable.h"
+#include "futex.h"
 
 //----------------------------------------------------------------------
 // Kernel::Kernel
@@ -26,8 +30,14 @@
 
 Kernel::Kernel(int argc, char **argv)
 {
+    ExecEntry *lastExec = NULL;
+
     randomSlice = FALSE; 
+    instrSlice = 0;
+    schedulerType = FIFO;
+    numCPUs = 1;
     debugUserProg = FALSE;
+    profileSynch = FALSE;
     consoleIn = NULL;          // default is stdin
     consoleOut = NULL;         // default is stdout
 #ifndef FILESYS_STUB
@@ -36,6 +46,7 @@ Kernel::Kernel(int argc, char **argv)
     reliability = 1;            // network reliability, default is 1.0
     hostName = 0;               // machine id, also UNIX socket name
                                 // 0 is the default machine id
+    execfile = new List<ExecEntry *>;
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-rs") == 0) {
  	    	ASSERT(i + 1 < argc);
@@ -43,11 +54,72 @@ Kernel::Kernel(int argc, char **argv)
 			// number generator
 	    	randomSlice = TRUE;
 	    	i++;
+        } else if (strcmp(argv[i], "-is") == 0) {
+	    	ASSERT(i + 1 < argc && atoi(argv[i + 1]) > 0);
+	    	instrSlice = atoi(argv[i + 1]);
+	    	i++;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+        } else if (strcmp(argv[i], "-ps") == 0) {
+            profileSynch = TRUE;
+        } else if (strcmp(argv[i], "-sched") == 0) {
+	    	ASSERT(i + 1 < argc);
+	    	if (strcmp(argv[i + 1], "fifo") == 0) {
+		    schedulerType = FIFO;
+	    	} else if (strcmp(argv[i + 1], "mlfq") == 0) {
+		    schedulerType = MLFQ;
+	    	} else if (strcmp(argv[i + 1], "sjf") == 0) {
+		    schedulerType = SJF;
+	    	} else if (strcmp(argv[i + 1], "psjf") == 0) {
+		    schedulerType = PSJF;
+	    	} else if (strcmp(argv[i + 1], "stride") == 0) {
+		    schedulerType = STRIDE;
+	    	} else if (strcmp(argv[i + 1], "lottery") == 0) {
+		    schedulerType = LOTTERY;
+	    	} else {
+		    cerr << "Unknown scheduler " << argv[i + 1] << "\n";
+		    ASSERTNOTREACHED();
+	    	}
+	    	i++;
+		} else if (strcmp(argv[i], "-cpus") == 0) {
+	    	ASSERT(i + 1 < argc);
+	    	numCPUs = atoi(argv[i + 1]);
+	    	if (numCPUs < 1 || numCPUs > MaxCPUs) {
+		    cerr << "Number of CPUs must be between 1 and " << MaxCPUs
+			<< "\n";
+		    ASSERTNOTREACHED();
+	    	}
+	    	i++;
 		} else if (strcmp(argv[i], "-e") == 0) {
-        	execfile[++execfileNum]= argv[++i];
-			cout << execfile[execfileNum] << "\n";
+	    	ASSERT(i + 1 < argc);
+			lastExec = new ExecEntry(argv[++i]);
+        	execfile->Append(lastExec);
+			cout << argv[i] << "\n";
+		} else if (strcmp(argv[i], "-tk") == 0) {
+	    	ASSERT(i + 1 < argc && lastExec != NULL);
+	    	ASSERT(atoi(argv[i + 1]) > 0);
+	    	lastExec->params.tickets = atoi(argv[i + 1]);	// for the last "-e"
+	    	i++;
+		} else if (strcmp(argv[i], "-pri") == 0) {
+	    	ASSERT(i + 1 < argc && lastExec != NULL);
+	    	if (atoi(argv[i + 1]) < 0
+			|| atoi(argv[i + 1]) >= NumPriorities) {
+		    cerr << "Priority must be between 0 and "
+			<< NumPriorities - 1 << "\n";
+		    ASSERTNOTREACHED();
+	    	}
+	    	lastExec->params.priority = atoi(argv[i + 1]);	// ditto
+	    	i++;
+		} else if (strcmp(argv[i], "-rt") == 0) {
+	    	ASSERT(i + 2 < argc && lastExec != NULL);
+	    	lastExec->params.rtPeriod = atoi(argv[i + 1]);	// ditto
+	    	lastExec->params.rtBudget = atoi(argv[i + 2]);
+	    	i += 2;
+		} else if (strcmp(argv[i], "-q") == 0) {
+	    	ASSERT(i + 2 < argc && lastExec != NULL);
+	    	lastExec->params.quotaPeriod = atoi(argv[i + 1]);	// ditto
+	    	lastExec->params.quotaBudget = atoi(argv[i + 2]);
+	    	i += 2;
 		} else if (strcmp(argv[i], "-ci") == 0) {
 	    	ASSERT(i + 1 < argc);
 	    	consoleIn = argv[i + 1];
@@ -69,8 +141,11 @@ Kernel::Kernel(int argc, char **argv)
             hostName = atoi(argv[i + 1]);
             i++;
         } else if (strcmp(argv[i], "-u") == 0) {
-            cout << "Partial usage: nachos [-rs randomSeed]\n";
-	   		cout << "Partial usage: nachos [-s]\n";
+            cout << "Partial usage: nachos [-rs randomSeed] [-is #]\n";
+	   		cout << "Partial usage: nachos [-s] [-ps]\n";
+	   		cout << "Partial usage: nachos [-sched fifo|mlfq|sjf|psjf|stride|lottery]\n";
+	   		cout << "Partial usage: nachos [-cpus #]\n";
+	   		cout << "Partial usage: nachos [-e file [-tk tickets] [-pri level] [-rt period budget] [-q period budget]]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
 	    	cout << "Partial usage: nachos [-nf]\n";
@@ -95,14 +170,17 @@ Kernel::Initialize()
     // object to save its state. 
 
 	
-    currentThread = new Thread("main", threadNum++);
+    currentThread = new Thread("main", KernelPID);
     currentThread->setStatus(RUNNING);
 
     stats = new Statistics();		// collect statistics
     interrupt = new Interrupt;		// start up interrupt handling
-    scheduler = new Scheduler();	// initialize the ready queue
+    scheduler = new Scheduler(schedulerType, numCPUs);	// initialize the ready queue
+    threadPool = new ThreadPool(InitialPooledThreads, MaxPooledThreads,
+					MaxPooledStacks);
+    processTable = new ProcessTable(InitialProcessTableSize);
     alarm = new Alarm(randomSlice);	// start up time slicing
-    machine = new Machine(debugUserProg);
+    machine = new Machine(debugUserProg, instrSlice);
     synchConsoleIn = new SynchConsoleInput(consoleIn); // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
     synchDisk = new SynchDisk();    //
@@ -113,6 +191,8 @@ Kernel::Initialize()
 #endif // FILESYS_STUB
     postOfficeIn = new PostOfficeInput(10);
     postOfficeOut = new PostOfficeOutput(reliability);
+    execCache = new ExecCache(MaxCachedExecs);
+    futexTable = new FutexTable();
 
     /************************************/
     usedPhyPage = new UsedPhyPage();
@@ -128,6 +208,10 @@ Kernel::Initialize()
 
 Kernel::~Kernel()
 {
+    delete processTable;	// these go first: deleting the threads
+    delete futexTable;		// they hold still uses the statistics
+    delete threadPool;		// (see ThreadPool::PutStack)
+    delete execCache;
     delete stats;
     delete interrupt;
     delete scheduler;
@@ -139,6 +223,10 @@ Kernel::~Kernel()
     delete fileSystem;
     delete postOfficeIn;
     delete postOfficeOut;
+    while (!execfile->IsEmpty()) {
+	delete execfile->RemoveFront();
+    }
+    delete execfile;
 
     /************************************/
     delete usedPhyPage;
@@ -149,23 +237,49 @@ Kernel::~Kernel()
 
 //----------------------------------------------------------------------
 // Kernel::ThreadSelfTest
-//      Test threads, semaphores, synchlists
+//      Test threads, semaphores, locks, reader-writer locks, sequence
+//	locks, once objects, barriers, synchlists
 //----------------------------------------------------------------------
 
 void
 Kernel::ThreadSelfTest() {
    Semaphore *semaphore;
+   Lock *lock;
+   RWLock *rwLock;
+   SeqLock *seqLock;
+   Once *once;
+   Barrier *barrier;
    SynchList<int> *synchList;
    
    LibSelfTest();		// test library routines
    
    currentThread->SelfTest();	// test thread switching
+   scheduler->SelfTest();	// test real-time budgets
    
    				// test semaphore operation
    semaphore = new Semaphore("test", 0);
    semaphore->SelfTest();
    delete semaphore;
    
+   				// test priority inheritance
+   lock = new Lock("test");
+   lock->SelfTest();
+   delete lock;
+   
+   				// test the read-mostly primitives
+   rwLock = new RWLock("test");
+   rwLock->SelfTest();
+   delete rwLock;
+   seqLock = new SeqLock("test");
+   seqLock->SelfTest();
+   delete seqLock;
+   once = new Once("test");
+   once->SelfTest();
+   delete once;
+   barrier = new Barrier("test", 3);
+   barrier->SelfTest();
+   delete barrier;
+   
    				// test locks, condition variables
 				// using synchronized lists
    synchList = new SynchList<int>;
@@ -174,6 +288,200 @@ Kernel::ThreadSelfTest() {
 
 }
 
+//----------------------------------------------------------------------
+// Kernel::SynchBenchmark, BenchProducer, BenchConsumer
+//      Measure the cost of synchronization: producer threads pass
+//	BenchItems items each to the same number of consumer threads,
+//	which keep finding nothing to consume, so that nearly every
+//	item costs a Lock Acquire/Release pair, a Condition Wait and
+//	Signal, and a context switch.  Report the host processor time
+//	this takes, and the simulated time.
+//
+//	This is done three ways:
+//	  - through a bounded buffer, guarded by a Lock and two
+//	    Conditions, which itself allocates nothing -- so this
+//	    measures Lock and Condition directly;
+//	  - through the same buffer, but with the Condition that Nachos
+//	    used to have (see OldCondition), as the baseline;
+//	  - through a SynchList, which allocates a list element for
+//	    each item, as it would be used in practice.
+//----------------------------------------------------------------------
+
+static const int BenchThreads = 4;	// producers, and as many consumers
+static const int BenchItems = 20000;	// items per producer
+static const int BenchBufferSize = 8;	// items the bounded buffer holds
+static Semaphore *benchDone;
+
+// The original Nachos condition variable, kept as the benchmark's
+// baseline: every Wait allocates a Semaphore to sleep on, and a list
+// element to queue it on.
+
+class OldCondition {
+  public:
+    OldCondition(char* debugName) { waitQueue = new List<Semaphore *>; }
+    ~OldCondition() { delete waitQueue; }
+
+    void Wait(Lock *conditionLock) {
+	Semaphore *waiter = new Semaphore("condition", 0);
+
+	waitQueue->Append(waiter);
+	conditionLock->Release();
+	waiter->P();
+	conditionLock->Acquire();
+	delete waiter; }
+    void Signal(Lock *conditionLock) {
+	if (!waitQueue->IsEmpty()) {
+	    waitQueue->RemoveFront()->V();
+	} }
+
+  private:
+    List<Semaphore *> *waitQueue;	// semaphores of waiting threads
+};
+
+// A bounded buffer of items, using condition variables of type "C"
+// (Condition or OldCondition).
+
+template <class C>
+class BenchBuffer {
+  public:
+    BenchBuffer() {
+	lock = new Lock("bench buffer");
+	notEmpty = new C("bench not empty");
+	notFull = new C("bench not full");
+	count = in = out = 0; }
+    ~BenchBuffer() { delete notFull; delete notEmpty; delete lock; }
+
+    void Put(int item) {
+	lock->Acquire();
+	while (count == BenchBufferSize) {
+	    notFull->Wait(lock);
+	}
+	items[in] = item;
+	in = (in + 1) % BenchBufferSize;
+	count++;
+	notEmpty->Signal(lock);
+	lock->Release(); }
+    int Get() {
+	int item;
+
+	lock->Acquire();
+	while (count == 0) {
+	    notEmpty->Wait(lock);
+	}
+	item = items[out];
+	out = (out + 1) % BenchBufferSize;
+	count--;
+	notFull->Signal(lock);
+	lock->Release();
+	return item; }
+
+  private:
+    Lock *lock;
+    C *notEmpty;		// signalled when an item is put in
+    C *notFull;			// signalled when an item is taken out
+    int items[BenchBufferSize];
+    int count, in, out;		// # of items, where the next goes in,
+				// and where the next comes out
+};
+
+template <class C>
+static void
+BufferProducer(BenchBuffer<C> *buffer)
+{
+    for (int i = 0; i < BenchItems; i++) {
+	buffer->Put(i);
+    }
+    benchDone->V();
+}
+
+template <class C>
+static void
+BufferConsumer(BenchBuffer<C> *buffer)
+{
+    for (int i = 0; i < BenchItems; i++) {
+	(void) buffer->Get();
+    }
+    benchDone->V();
+}
+
+static void
+ListProducer(SynchList<int> *list)
+{
+    for (int i = 0; i < BenchItems; i++) {
+	list->Append(i);
+    }
+    benchDone->V();
+}
+
+static void
+ListConsumer(SynchList<int> *list)
+{
+    for (int i = 0; i < BenchItems; i++) {
+	(void) list->RemoveFront();
+    }
+    benchDone->V();
+}
+
+// Run one way of passing items, and report how long it took; returns
+// the host time in seconds.
+
+static double
+TimeBench(char *what, VoidFunctionPtr producer, VoidFunctionPtr consumer,
+	  void *arg)
+{
+   int startTicks = kernel->stats->totalTicks;
+   double startTime = HostCPUTime();
+   double elapsed;
+
+   for (int i = 0; i < BenchThreads; i++) {
+      (new Thread("consumer", 1))->Fork(consumer, arg);
+      (new Thread("producer", 1))->Fork(producer, arg);
+   }
+   for (int i = 0; i < 2 * BenchThreads; i++) {
+      benchDone->P();
+   }
+   elapsed = HostCPUTime() - startTime;
+
+   cout << "  " << what << ": host time " << elapsed << " seconds";
+   if (elapsed > 0) {
+      cout << " (" << (int) (BenchThreads * BenchItems / elapsed)
+	   << " items/second)";
+   }
+   cout << ", simulated time " << kernel->stats->totalTicks - startTicks
+	<< " ticks\n";
+   return elapsed;
+}
+
+void
+Kernel::SynchBenchmark() {
+   BenchBuffer<Condition> *buffer = new BenchBuffer<Condition>;
+   BenchBuffer<OldCondition> *oldBuffer = new BenchBuffer<OldCondition>;
+   SynchList<int> *list = new SynchList<int>;
+   double newTime, oldTime;
+
+   benchDone = new Semaphore("benchmark done", 0);
+   cout << "Synchronization benchmark: " << BenchThreads * BenchItems
+	<< " items, " << BenchThreads << " producers, " << BenchThreads
+	<< " consumers\n";
+   newTime = TimeBench("Lock + Condition",
+		(VoidFunctionPtr) BufferProducer<Condition>,
+		(VoidFunctionPtr) BufferConsumer<Condition>, buffer);
+   oldTime = TimeBench("Lock + old Condition",
+		(VoidFunctionPtr) BufferProducer<OldCondition>,
+		(VoidFunctionPtr) BufferConsumer<OldCondition>, oldBuffer);
+   if (newTime > 0) {
+      cout << "  Condition is " << oldTime / newTime
+	   << " times as fast as the old one\n";
+   }
+   (void) TimeBench("SynchList", (VoidFunctionPtr) ListProducer,
+		(VoidFunctionPtr) ListConsumer, list);
+
+   delete benchDone;
+   delete list;
+   delete oldBuffer;
+   delete buffer;
+}
+
 //----------------------------------------------------------------------
 // Kernel::ConsoleTest
 //      Test the synchconsole
@@ -259,7 +567,7 @@ Kernel::NetworkTest() {
 void ForkExecute(Thread *t)
 {
 	if ( !t->space->Load(t->getName()) ) {
-    	return;             // executable not found
+    	kernel->ExitProcess(-1);    // executable not found
     }
 	
     t->space->Execute(t->getName());
@@ -270,16 +578,12 @@ void Kernel::ExecAll()
 {
     /*****************************************************************************/
     // cout << "In kernel::ExecAll" << endl; 
-     //cout << "\texecfileNum = " << execfileNum << endl;
-    // execfileNum 會在 command line 時就決定，記錄要跑幾個程式
+    // execfile 會在 command line 時就決定，記錄要跑哪些程式
     /*****************************************************************************/
 
-	for (int i=1;i<=execfileNum;i++) {
-        /*****************************************************************/
-        // cout << "In kernel::ExecAll" << endl;
-        //cout << "\tfile " << i << endl;
-        /*****************************************************************/
-		int a = Exec(execfile[i]);
+	ListIterator<ExecEntry *> iter(execfile);
+	for (; !iter.IsDone(); iter.Next()) {
+		(void) Exec(iter.Item()->name, &iter.Item()->params);
 	}
     // cout << "currectThread = " << currentThread->getName() << endl;
 	currentThread->Finish();
@@ -287,48 +591,218 @@ void Kernel::ExecAll()
 }
 
 
-int Kernel::Exec(char* name)
+int Kernel::Exec(char* name, SchedParams *params)
 {   
-    /************************************************/
-    // t 為 Thread*
+	return ExecV(1, &name, params);
+}
 
-	t[threadNum] = new Thread(name, threadNum);     
-    // 新增 Thread
-    // 此時 status 為 JUST_CREATED
+//----------------------------------------------------------------------
+// Kernel::ExecV
+// 	Start a user program in a new thread, passing it arguments.
+//	The thread control block (and its stack) comes from the thread
+//	pool, so starting a program is cheap.
+//
+//	Returns the new process ID, for Join, or -1 if we can't start
+//	the program, or it asks for a real-time reservation that can't
+//	be granted, or for a CPU quota that makes no sense.  (If the
+//	executable can't be loaded, the thread exits with status -1.)
+//
+//	"argc" is the number of arguments, including the program name
+//	"argv" is the arguments; argv[0] is the executable's file name
+//	"params" is how the program is to be scheduled
+//----------------------------------------------------------------------
+
+int Kernel::ExecV(int argc, char** argv, SchedParams *params)
+{
+    AddrSpace *space;
+    Thread *thread;
+    IntStatus oldLevel;
+    bool admitted;
+    int pid;
+
+    if (!scheduler->CanAdmit(params->rtPeriod, params->rtBudget)) {
+	cerr << "Can't reserve " << params->rtBudget << " ticks every "
+		<< params->rtPeriod << " for " << argv[0] << "\n";
+	return -1;
+    }
+    if (params->quotaPeriod < 0 || (params->quotaPeriod > 0
+		&& (params->quotaBudget <= 0
+		    || params->quotaBudget > params->quotaPeriod))) {
+	cerr << "Bad CPU quota of " << params->quotaBudget << " ticks every "
+		<< params->quotaPeriod << " for " << argv[0] << "\n";
+	return -1;
+    }
 
-	t[threadNum]->space = new AddrSpace();
-    // space 為 AddrSpace*
+    space = new AddrSpace();
     // 這邊的 new 原本會製造 pagetable，但因為我們要做 runtime address binding 故這邊先什麼都不做
-    
-	t[threadNum]->Fork((VoidFunctionPtr) &ForkExecute, (void *)t[threadNum]);
-	threadNum++;
-
-	return threadNum-1;
-/*
-    cout << "Total threads number is " << execfileNum << endl;
-    for (int n=1;n<=execfileNum;n++) {
-		t[n] = new Thread(execfile[n]);
-		t[n]->space = new AddrSpace();
-		t[n]->Fork((VoidFunctionPtr) &ForkExecute, (void *)t[n]);
-		cout << "Thread " << execfile[n] << " is executing." << endl;
+    if (!space->SetArguments(argc, argv)) {
+	cerr << "Arguments to " << argv[0] << " are too long\n";
+	delete space;
+	return -1;
+    }
+
+    pid = processTable->Allocate(currentThread->getID());
+				// claim the ID before Fork, which
+				// may let another thread run
+	thread = threadPool->Get(space->getName(), pid);
+    // 新增 Thread
+    // 此時 status 為 JUST_CREATED
+	thread->space = space;
+	(void) space->AddThread(thread, 0);
+	thread->setTickets(params->tickets);
+	thread->setPriority(params->priority);
+	if (params->rtPeriod > 0) {
+	    oldLevel = interrupt->SetLevel(IntOff);
+	    admitted = scheduler->SetRealTime(thread, params->rtPeriod,
+						params->rtBudget);
+	    ASSERT(admitted);		// nothing else ran since CanAdmit
+	    (void) interrupt->SetLevel(oldLevel);
 	}
-	cout << "debug Kernel::Run finished.\n";	
-*/
-//  Thread *t1 = new Thread(execfile[1]);
-//  Thread *t1 = new Thread("../test/test1");
-//  Thread *t2 = new Thread("../test/test2");
-
-//    AddrSpace *halt = new AddrSpace();
-//  t1->space = new AddrSpace();
-//  t2->space = new AddrSpace();
-
-//    halt->Execute("../test/halt");
-//  t1->Fork((VoidFunctionPtr) &ForkExecute, (void *)t1);
-//  t2->Fork((VoidFunctionPtr) &ForkExecute, (void *)t2);
-
-//	currentThread->Finish();
-//    Kernel::Run();
-//  cout << "after ThreadedKernel:Run();" << endl;  // unreachable
+	if (params->quotaPeriod > 0) {
+	    oldLevel = interrupt->SetLevel(IntOff);
+	    thread->quota = scheduler->NewQuota(space->getName(),
+				params->quotaPeriod, params->quotaBudget);
+	    (void) interrupt->SetLevel(oldLevel);
+	}
+	processTable->Lookup(pid)->thread = thread;
+    
+	thread->Fork((VoidFunctionPtr) &ForkExecute, (void *)thread);
+
+	return pid;
+}
+
+//----------------------------------------------------------------------
+// Kernel::Join
+// 	Wait for a user program started by the current one to exit.
+//
+//	Returns the status the program passed to Exit, or -1 if
+//	"threadID" isn't a child of the current program.
+//----------------------------------------------------------------------
+
+int Kernel::Join(int threadID)
+{
+    return processTable->Join(threadID, currentThread->getID());
+}
+
+//----------------------------------------------------------------------
+// Kernel::ExitProcess
+// 	The current user program is done: record its exit status, and
+//	finish the thread.  Only the calling thread stops: if other
+//	threads of the program are still running, they go on, and the
+//	program hasn't exited until they have called ThreadExit too (see
+//	ExitThread, and test/thread_test1.c).
+//
+//	"status" is the program's exit status
+//----------------------------------------------------------------------
+
+void Kernel::ExitProcess(int status)
+{
+    DEBUG(dbgSys, "Process " << currentThread->getID()
+		<< " exits with status " << status);
+    if (currentThread->space != NULL) {
+	currentThread->space->setExitStatus(status);
+    }
+    ExitThread(status);
+}
+
+//----------------------------------------------------------------------
+// Kernel::ForkThread
+// 	Start a new thread in the current user program, running "func"
+//	on a user stack of its own.  It shares the program's address
+//	space and process ID, and is scheduled like the thread that
+//	forked it.
+//
+//	Returns the new thread's ID within the program, for ThreadJoin,
+//	or -1 if there is no memory for its stack.
+//
+//	"func" is the virtual address of the function to run
+//	"retAddr" is where "func" returns to: the user program's stub
+//	    that calls ThreadExit (see start.S)
+//----------------------------------------------------------------------
+
+static void
+ForkUserThread(Thread *t)
+{
+    t->space->StartThread(t->userFunc, t->userStack, t->userReturn);
+}
+
+int Kernel::ForkThread(int func, int retAddr)
+{
+    AddrSpace *space = currentThread->space;
+    Thread *thread;
+    int stackTop, tid;
+
+    ASSERT(space != NULL);
+    stackTop = space->AllocateStack();
+    if (stackTop == 0) {
+	cerr << "Not enough free memory for a thread of "
+		<< space->getName() << "\n";
+	return -1;
+    }
+    thread = threadPool->Get(space->getName(), currentThread->getID());
+    thread->space = space;
+    thread->userFunc = func;
+    thread->userStack = stackTop;
+    thread->userReturn = retAddr;
+    thread->setTickets(currentThread->getTickets());
+    thread->setPriority(currentThread->getPriority());
+    thread->quota = currentThread->quota;	// shares the program's quota
+    tid = space->AddThread(thread, stackTop);
+    DEBUG(dbgSys, "Forking thread " << tid << " of " << space->getName());
+    thread->Fork((VoidFunctionPtr) &ForkUserThread, (void *) thread);
+    return tid;
+}
+
+//----------------------------------------------------------------------
+// Kernel::ExitThread
+// 	The current thread of a user program is done: wake up the
+//	threads joining it, and finish it.  If it was the program's
+//	last thread, the program has exited, with the status it last
+//	passed to Exit: wake up its parent if it is waiting in Join.
+//	The address space is de-allocated once all its threads have
+//	been switched out (see ThreadPool::Put).
+//
+//	The thread's CPU accounting is added to the program's, which is
+//	printed when the program exits.
+//
+//	"status" is the thread's exit status
+//----------------------------------------------------------------------
+
+void Kernel::ExitThread(int status)
+{
+    AddrSpace *space = currentThread->space;
+    int pid = currentThread->getID();
+    Process *proc = (pid != KernelPID) ? processTable->Lookup(pid) : NULL;
+
+    if (proc != NULL) {
+	proc->account.Add(&currentThread->account);
+    }
+    if (space != NULL && !space->RemoveThread(currentThread, status)) {
+	currentThread->Finish();	// the program goes on without us
+	ASSERTNOTREACHED();
+    }
+    if (proc != NULL) {
+	cout << "Program " << currentThread->getName() << " (pid " << pid
+		<< ") exited:\n";
+	proc->account.Print();
+	processTable->Exited(pid, 
+			(space != NULL) ? space->getExitStatus() : status);
+    }
+    currentThread->Finish();
+    ASSERTNOTREACHED();
+}
+
+//----------------------------------------------------------------------
+// Kernel::getThread
+// 	Return the thread running a user program, or NULL if there is
+//	no such program (or it has exited).
+//----------------------------------------------------------------------
+
+Thread* Kernel::getThread(int threadID)
+{
+    Process *proc = processTable->Lookup(threadID);
+
+    return (proc == NULL ? NULL : proc->thread);
 }
 
 int Kernel::CreateFile(char *filename)
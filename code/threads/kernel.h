@@ -24,6 +24,10 @@ class PostOfficeOutput;
 class SynchConsoleInput;
 class SynchConsoleOutput;
 class SynchDisk;
+class ExecCache;
+class ThreadPool;
+class ProcessTable;
+class FutexTable;
 
 
 /**************************/
@@ -65,6 +69,18 @@ public:
 /**************************/
 
 
+// A user program to run, from the command line ("-e"), and how it
+// is to be scheduled ("-tk", "-rt").
+
+class ExecEntry {
+  public:
+    ExecEntry(char *fileName) : params(DefaultTickets) { name = fileName; }
+
+    char *name;			// executable to run
+    SchedParams params;		// its tickets, priority, real-time
+				// reservation
+};
+
 class Kernel {
   public:
     Kernel(int argc, char **argv);
@@ -75,12 +91,32 @@ class Kernel {
 				// from constructor because 
 				// refers to "kernel" as a global
 	void ExecAll();
-	int Exec(char* name);
+	int Exec(char* name, SchedParams *params);
+	int ExecV(int argc, char** argv, SchedParams *params);
+				// run a user program in a new thread,
+				// scheduled according to "params";
+				// returns its ID, or -1 on failure
+	int Join(int threadID);	// wait for a user program to exit;
+				// returns its exit status
+	void ExitProcess(int status);
+				// the current user program is done
+	int ForkThread(int func, int retAddr);
+				// start a thread running "func" in
+				// the current user program, returning
+				// to "retAddr"; returns its ID, or -1
+				// on failure
+	void ExitThread(int status);
+				// the current thread of a user
+				// program is done
     void ThreadSelfTest();	// self test of threads and synchronization
+    void SynchBenchmark();	// time producers and consumers passing
+				// items through Lock and Condition, the
+				// old Condition, and a SynchList
 	
     void ConsoleTest();         // interactive console self test
     void NetworkTest();         // interactive 2-machine network test
-	Thread* getThread(int threadID){return t[threadID];}    
+	Thread* getThread(int threadID);	// thread running process
+						// "threadID", or NULL
 	
 	int CreateFile(char* filename); // fileSystem call
 
@@ -102,6 +138,11 @@ class Kernel {
     FileSystem *fileSystem;     
     PostOfficeInput *postOfficeIn;
     PostOfficeOutput *postOfficeOut;
+    ExecCache *execCache;	// executables we have already parsed
+    ThreadPool *threadPool;	// finished threads and unused stacks,
+				// kept for reuse
+    ProcessTable *processTable;	// user programs we have started
+    FutexTable *futexTable;	// user threads waiting on futexes
 
 
     /**************************/
@@ -109,17 +150,19 @@ class Kernel {
     /**************************/
 
     int hostName;               // machine identifier
-  /**************************/
-	Thread* t[10];
-  int threadNum;
-  /***************************/
+    bool profileSynch;		// count contention on semaphores,
+				// locks and condition variables?
   private:
 
 
-	char*   execfile[10];
-	int execfileNum;
+	List<ExecEntry *> *execfile;	// programs to run, from the
+					// command line
 
     bool randomSlice;		// enable pseudo-random time slicing
+    int instrSlice;		// time-slice user programs every so
+				// many instructions; 0 to use the timer
+    SchedulerType schedulerType;	// scheduling policy
+    int numCPUs;		// # of simulated CPUs
     bool debugUserProg;         // single step user program
     double reliability;         // likelihood messages are dropped
     char *consoleIn;            // file to read console input from
@@ -2,23 +2,45 @@
 //	Driver code to initialize, selftest, and run the 
 //	operating system kernel.  
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
-//              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
+// Usage: nachos -d <debugflags> -rs <random seed #> -is <#> -sched <policy>
+//              -cpus <#>
+//              -s -ps -x <nachos file> -ci <consoleIn> -co <consoleOut>
 //              -f -cp <unix file> <nachos file>
 //              -p <nachos file> -r <nachos file> -l -D
 //              -n <network reliability> -m <machine id>
-//              -z -K -C -N
+//              -z -K -B -C -N
 //
 //    -d causes certain debugging messages to be printed (see debug.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -is time-slices user programs every <#> user instructions, rather
+//	than by the timer, so that how they interleave doesn't depend on
+//	how long the kernel takes (for comparing one build with another)
+//    -sched selects the scheduling policy: fifo (the default), mlfq,
+//	sjf, psjf, stride or lottery (see scheduler.h)
+//    -cpus sets the number of CPUs in the model of a multi-CPU
+//	machine (1, the default, to 8).  The CPUs take turns on the one
+//	host thread Nachos runs on: this shows how threads are spread
+//	over CPUs, and programs don't finish any sooner with more
+//    -e runs a user program (any number of times); -tk after it
+//	gives the program that many tickets (stride, lottery), -pri
+//	<level> gives it that priority (0, the highest, to 7; fifo runs
+//	the most important ready thread first, and mlfq starts it at
+//	that level), -rt <period> <budget> after it makes it a real-time
+//	program, and -q <period> <budget> limits its threads to that many
+//	CPU ticks every period
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
+//    -ps counts how long threads wait for semaphores, locks and
+//	condition variables, and prints the counts at shutdown
 //    -x runs a user program
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
 //    -n sets the network reliability
 //    -m sets this machine's host id (needed for the network)
 //    -K run a simple self test of kernel threads and synchronization
+//    -B time threads passing items through a buffer guarded by a Lock
+//	and Conditions (and, for comparison, by the old semaphore-based
+//	Condition), and through a SynchList
 //    -C run an interactive console test
 //    -N run a two-machine network test (see Kernel::NetworkTest)
 //
@@ -170,6 +192,7 @@ main(int argc, char **argv)
     char *debugArg = "";
     char *userProgName = NULL;        // default is not to execute a user prog
     bool threadTestFlag = false;
+    bool benchmarkFlag = false;
     bool consoleTestFlag = false;
     bool networkTestFlag = false;
 #ifndef FILESYS_STUB
@@ -201,6 +224,9 @@ main(int argc, char **argv)
 	else if (strcmp(argv[i], "-K") == 0) {
 	    threadTestFlag = TRUE;
 	}
+	else if (strcmp(argv[i], "-B") == 0) {
+	    benchmarkFlag = TRUE;
+	}
 	else if (strcmp(argv[i], "-C") == 0) {
 	    consoleTestFlag = TRUE;
 	}
@@ -234,7 +260,7 @@ main(int argc, char **argv)
 	else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-z -d debugFlags]\n";
             cout << "Partial usage: nachos [-x programName]\n";
-	    cout << "Partial usage: nachos [-K] [-C] [-N]\n";
+	    cout << "Partial usage: nachos [-K] [-B] [-C] [-N]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
@@ -258,6 +284,9 @@ main(int argc, char **argv)
     if (threadTestFlag) {
       kernel->ThreadSelfTest();  // test threads and synchronization
     }
+    if (benchmarkFlag) {
+      kernel->SynchBenchmark();  // time synchronization
+    }
     if (consoleTestFlag) {
       kernel->ConsoleTest();   // interactive test of the synchronized console
     }
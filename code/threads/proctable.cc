@@ -0,0 +1,252 @@
+// proctable.cc
+//	Routines to manage the table of running user programs.
+//
+//	The table is an array indexed by process ID, together with a
+//	stack of the IDs that are free; when the stack runs dry, the
+//	array is doubled in size.
+//
+//	These routines are called from system calls, with interrupts
+//	enabled, but they never block (except Join, which waits on a
+//	semaphore) and we are on a uniprocessor.  Nothing in here can
+//	cause a context switch in the middle of updating the table.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "proctable.h"
+
+//----------------------------------------------------------------------
+// Process::Process
+// 	Initialize a process table entry, for a program that hasn't
+//	started running yet.
+//
+//	"parentPID" is the process that may Join this one
+//----------------------------------------------------------------------
+
+Process::Process(int parentPID)
+{
+    thread = NULL;
+    parentID = parentPID;
+    numChildren = 0;
+    done = FALSE;
+    joined = FALSE;
+    exitStatus = 0;
+    exited = new Semaphore("exit", 0);
+}
+
+//----------------------------------------------------------------------
+// Process::~Process
+// 	De-allocate a process table entry.
+//----------------------------------------------------------------------
+
+Process::~Process()
+{
+    delete exited;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::ProcessTable
+// 	Initialize the process table.  The only entry in use is the
+//	kernel's, with ID 0.
+//
+//	"initialSize" is the number of entries to start out with
+//----------------------------------------------------------------------
+
+ProcessTable::ProcessTable(int initialSize)
+{
+    int pid;
+
+    ASSERT(initialSize > 0);
+    tableSize = initialSize;
+    table = new Process *[tableSize];
+    freeIDs = new int[tableSize];
+    numFree = 0;
+    for (int i = tableSize - 1; i >= 0; i--) {	// hand out low IDs first
+	table[i] = NULL;
+	freeIDs[numFree++] = i;
+    }
+    numInUse = 0;
+
+    pid = Allocate(KernelPID);		// the kernel's own entry
+    ASSERT(pid == KernelPID);
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::~ProcessTable
+// 	De-allocate the process table, and all of its entries.
+//----------------------------------------------------------------------
+
+ProcessTable::~ProcessTable()
+{
+    for (int i = 0; i < tableSize; i++) {
+	delete table[i];
+    }
+    delete [] table;
+    delete [] freeIDs;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Grow
+// 	Double the size of the table; the new IDs are all free.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Grow()
+{
+    int newSize = tableSize * 2;
+    Process **newTable = new Process *[newSize];
+    int *newFreeIDs = new int[newSize];
+
+    DEBUG(dbgThread, "Growing process table to " << newSize << " entries");
+    for (int i = 0; i < tableSize; i++) {
+	newTable[i] = table[i];
+    }
+    for (int i = 0; i < numFree; i++) {
+	newFreeIDs[i] = freeIDs[i];
+    }
+    for (int i = newSize - 1; i >= tableSize; i--) {
+	newTable[i] = NULL;
+	newFreeIDs[numFree++] = i;
+    }
+    delete [] table;
+    delete [] freeIDs;
+    table = newTable;
+    freeIDs = newFreeIDs;
+    tableSize = newSize;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Allocate
+// 	Set up a new entry, and return its process ID.  The caller
+//	fills in the thread once it has been created.
+//
+//	"parentPID" is the process that may Join the new one
+//----------------------------------------------------------------------
+
+int
+ProcessTable::Allocate(int parentPID)
+{
+    int pid;
+
+    if (numFree == 0) {
+	Grow();
+    }
+    pid = freeIDs[--numFree];
+    ASSERT(table[pid] == NULL);
+    table[pid] = new Process(parentPID);
+    numInUse++;
+    if (pid != parentPID) {
+	table[parentPID]->numChildren++;
+    }
+    return pid;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Lookup
+// 	Return the entry for a process ID, or NULL if the ID is not
+//	in use.
+//----------------------------------------------------------------------
+
+Process *
+ProcessTable::Lookup(int pid)
+{
+    if (pid < 0 || pid >= tableSize) {
+	return NULL;
+    }
+    return table[pid];
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Free
+// 	The entry for "pid" is no longer needed; recycle its ID.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Free(int pid)
+{
+    Process *proc = table[pid];
+
+    ASSERT(proc != NULL && pid != KernelPID);
+    DEBUG(dbgThread, "Freeing process ID " << pid);
+    if (table[proc->parentID] != NULL) {
+	table[proc->parentID]->numChildren--;
+    }
+    delete proc;
+    table[pid] = NULL;
+    freeIDs[numFree++] = pid;
+    numInUse--;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Exited
+// 	Record that a program has exited.  If nobody can Join it, its
+//	entry is freed right away; otherwise its parent is woken up.
+//
+//	Its own children can no longer be Join'ed: those that have
+//	already exited are freed, the rest will be freed when they exit.
+//
+//	"pid" is the program that exited
+//	"status" is what it passed to Exit
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Exited(int pid, int status)
+{
+    Process *proc = Lookup(pid);
+
+    ASSERT(proc != NULL && !proc->done);
+    proc->done = TRUE;
+    proc->exitStatus = status;
+    proc->thread = NULL;	// about to finish
+
+    for (int i = 0; proc->numChildren > 0 && i < tableSize; i++) {
+	if (table[i] == NULL || table[i]->parentID != pid || i == pid) {
+	    continue;
+	}
+	if (table[i]->done) {
+	    Free(i);
+	} else {
+	    table[i]->parentID = KernelPID;	// orphaned
+	    proc->numChildren--;
+	    table[KernelPID]->numChildren++;
+	}
+    }
+
+    if (proc->parentID == KernelPID) {
+	Free(pid);
+    } else {
+	proc->exited->V();	// last, since the parent may free us
+    }
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Join
+// 	Wait for a child to exit, and return its exit status.  The
+//	child's entry is then freed, so a process can only be Join'ed
+//	once.
+//
+//	Returns -1 if "pid" isn't a child of the caller, or someone is
+//	already waiting for it.
+//
+//	"pid" is the process to wait for
+//	"callerPID" is the process doing the waiting
+//----------------------------------------------------------------------
+
+int
+ProcessTable::Join(int pid, int callerPID)
+{
+    Process *proc = Lookup(pid);
+    int status;
+
+    if (proc == NULL || pid == callerPID || proc->parentID != callerPID
+		|| proc->parentID == KernelPID || proc->joined) {
+	return -1;
+    }
+    proc->joined = TRUE;
+    proc->exited->P();
+    status = proc->exitStatus;
+    Free(pid);
+    return status;
+}
@@ -0,0 +1,86 @@
+// proctable.h
+//	Data structures to keep track of running user programs.
+//
+//	Every user program started by Kernel::Exec has an entry in the
+//	process table, indexed by its process ID (which is also the ID
+//	of the thread running it).  Process ID 0 is the kernel's own
+//	"main" thread.
+//
+//	The table grows as needed, and the IDs of entries that are no
+//	longer needed are recycled, so finding an entry, or a free ID,
+//	takes constant time no matter how many programs have been run.
+//
+//	An entry is no longer needed once its program has exited, and
+//	its parent has either collected the exit status with Join, or
+//	has itself exited.  Programs started by the kernel (from the
+//	command line) have no parent to Join them; their entries are
+//	freed as soon as they exit.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROCTABLE_H
+#define PROCTABLE_H
+
+#include "copyright.h"
+#include "thread.h"
+#include "synch.h"
+
+// Process ID of the kernel; also means "no parent".
+const int KernelPID = 0;
+
+// Number of process table entries we start out with; the table
+// doubles in size whenever it fills up.
+const int InitialProcessTableSize = 16;
+
+// The following class defines one entry of the process table.
+
+class Process {
+  public:
+    Process(int parentPID);	// initialize a new entry
+    ~Process();			// de-allocate the entry
+
+    Thread *thread;		// the thread running the program
+    int parentID;		// process that may Join us, or KernelPID
+    int numChildren;		// # of live entries with us as parent
+    bool done;			// has the program exited?
+    bool joined;		// is someone already waiting in Join?
+    int exitStatus;		// what the program passed to Exit
+    Semaphore *exited;		// signalled when the program exits
+    CPUAccount account;		// where the time of the program's
+				// threads that have exited went
+};
+
+// The following class defines the process table.
+
+class ProcessTable {
+  public:
+    ProcessTable(int initialSize);
+				// initialize a table with just the kernel
+    ~ProcessTable();		// de-allocate the table
+
+    int Allocate(int parentPID);// return the ID of a new entry
+    Process *Lookup(int pid);	// return the entry for "pid", or NULL
+    				// if there isn't one
+    void Exited(int pid, int status);
+				// the program has exited; wake up its
+				// parent, and reap what we can
+    int Join(int pid, int callerPID);
+				// wait for a child to exit, and
+				// return its exit status
+    int NumInUse() { return numInUse; }
+
+  private:
+    void Free(int pid);		// the entry is no longer needed
+    void Grow();		// double the size of the table
+
+    Process **table;		// entries, indexed by process ID;
+				// NULL if the ID is free
+    int tableSize;		// # of entries in "table"
+    int *freeIDs;		// stack of free process IDs
+    int numFree;		// # of IDs on "freeIDs"
+    int numInUse;		// # of entries in use
+};
+
+#endif // PROCTABLE_H
@@ -0,0 +1,206 @@
+// runqueue.cc
+//	Routines to manage a CPU's run queue: a circular buffer that
+//	only its owner adds to, and that any CPU may take from.
+//
+//	The indices "head" and "tail" wrap around at 2^32, which is a
+//	multiple of the capacity, so the number of threads on the queue
+//	is always tail - head.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "runqueue.h"
+#include "debug.h"
+
+//----------------------------------------------------------------------
+// RunQueue::RunQueue
+// 	Initialize an empty run queue.
+//
+//	"initialSize" is the number of threads it can hold to start
+//		with; must be a power of two
+//----------------------------------------------------------------------
+
+RunQueue::RunQueue(unsigned int initialSize)
+{
+    ASSERT(initialSize > 0 && (initialSize & (initialSize - 1)) == 0);
+    capacity = initialSize;
+    buffer = new Thread *[capacity];
+    head = tail = 0;
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// RunQueue::~RunQueue
+// 	De-allocate a run queue.  The threads on it are not touched.
+//----------------------------------------------------------------------
+
+RunQueue::~RunQueue()
+{
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// RunQueue::Push
+// 	Put a thread at the end of the queue.  Only the CPU that owns
+//	the queue may do this.
+//
+//	"thread" is the thread to be put on the queue
+//----------------------------------------------------------------------
+
+void
+RunQueue::Push(Thread *thread)
+{
+    if (tail - head == capacity) {
+	Grow();
+    }
+    buffer[tail & (capacity - 1)] = thread;
+    tail++;
+}
+
+//----------------------------------------------------------------------
+// RunQueue::PushNext
+// 	Put a thread in front of all the others, so that it runs next.
+//	If another thread was already to run next, it goes to the end
+//	of the queue.  Only the CPU that owns the queue may do this.
+//
+//	"thread" is the thread to be put on the queue
+//----------------------------------------------------------------------
+
+void
+RunQueue::PushNext(Thread *thread)
+{
+    if (next != NULL) {
+	Push(next);
+    }
+    next = thread;
+}
+
+//----------------------------------------------------------------------
+// RunQueue::Take
+// 	Take the thread at the front of the queue off it, and return
+//	it; NULL if the queue is empty.  This is how the owner finds
+//	the next thread to run.
+//----------------------------------------------------------------------
+
+Thread *
+RunQueue::Take()
+{
+    Thread *thread = next;
+
+    if (thread != NULL) {
+	next = NULL;
+	return thread;
+    }
+    if (head == tail) {
+	return NULL;
+    }
+    thread = buffer[head & (capacity - 1)];
+    head++;
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// RunQueue::TakeLast
+// 	Take the thread at the back of the queue off it, and return it;
+//	NULL if there is none.  This is how another CPU steals from the
+//	queue: it gets the thread that would have waited longest here,
+//	and leaves those about to run (including the one to run next,
+//	see PushNext) alone.
+//----------------------------------------------------------------------
+
+Thread *
+RunQueue::TakeLast()
+{
+    if (head == tail) {
+	return NULL;
+    }
+    tail--;
+    return buffer[tail & (capacity - 1)];
+}
+
+//----------------------------------------------------------------------
+// RunQueue::Remove
+// 	Take a thread off the queue from anywhere in it; the threads in
+//	front of it move back to close the gap.  This takes time in
+//	proportion to the length of the queue, but is only needed when
+//	a waiting thread's priority changes, and it has to move to
+//	another queue (see Scheduler::Reprioritize).
+//
+//	"thread" is the thread to take off; it must be on the queue
+//----------------------------------------------------------------------
+
+void
+RunQueue::Remove(Thread *thread)
+{
+    unsigned int i;
+
+    if (next == thread) {
+	next = NULL;
+	return;
+    }
+    for (i = head; i != tail && buffer[i & (capacity - 1)] != thread; i++) {
+	;
+    }
+    ASSERT(i != tail);
+    for (; i != head; i--) {
+	buffer[i & (capacity - 1)] = buffer[(i - 1) & (capacity - 1)];
+    }
+    head++;
+}
+
+//----------------------------------------------------------------------
+// RunQueue::Size
+// 	Return the number of threads on the queue.
+//----------------------------------------------------------------------
+
+unsigned int
+RunQueue::Size()
+{
+    return (tail - head) + (next != NULL ? 1 : 0);
+}
+
+//----------------------------------------------------------------------
+// RunQueue::Item
+// 	Return a thread on the queue, without taking it off.  For
+//	reporting statistics and debugging.
+//
+//	"i" is the position of the thread, counting from 0 at the front
+//----------------------------------------------------------------------
+
+Thread *
+RunQueue::Item(unsigned int i)
+{
+    ASSERT(i < Size());
+    if (next != NULL) {
+	if (i == 0) {
+	    return next;
+	}
+	i--;
+    }
+    return buffer[(head + i) & (capacity - 1)];
+}
+
+//----------------------------------------------------------------------
+// RunQueue::Grow
+// 	The buffer is full; double its size, keeping the threads in
+//	order.
+//----------------------------------------------------------------------
+
+void
+RunQueue::Grow()
+{
+    Thread **newBuffer = new Thread *[capacity * 2];
+    unsigned int size = tail - head;
+
+    DEBUG(dbgThread, "Growing run queue to " << capacity * 2 << " threads");
+    for (unsigned int i = 0; i < size; i++) {
+	newBuffer[i] = buffer[(head + i) & (capacity - 1)];
+    }
+    delete [] buffer;
+    buffer = newBuffer;
+    capacity *= 2;
+    head = 0;
+    tail = size;
+}
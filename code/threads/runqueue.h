@@ -0,0 +1,74 @@
+// runqueue.h
+//	Data structures for a CPU's queue of threads that are ready to
+//	run (see scheduler.h).
+//
+//	Each CPU has its own run queues, one for each effective priority
+//	(see Scheduler::Enqueue).  Only the CPU that owns a queue puts
+//	threads on it (except when a waiting thread's priority changes,
+//	and it moves to another of its CPU's queues); the owner takes
+//	them off the front, in FIFO order.  Another CPU that has nothing
+//	to do steals from the back instead -- the thread that would
+//	otherwise wait longest.
+//
+//	The queue is a circular buffer of thread pointers, which only
+//	has to be allocated again when it fills up.  There is also a
+//	slot for one thread that is to run before any of the others
+//	(see PushNext).
+//
+//	The CPUs take turns on one host thread (see scheduler.h), and
+//	interrupts are off whenever a queue is used, so no locking is
+//	needed: an operation on a queue is never interrupted by another.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef RUNQUEUE_H
+#define RUNQUEUE_H
+
+#include "copyright.h"
+#include "thread.h"
+
+// Number of threads a run queue can hold before its buffer has to
+// grow; must be a power of two.
+const unsigned int InitialRunQueueSize = 64;
+
+// The following class defines a CPU's run queue.
+
+class RunQueue {
+  public:
+    RunQueue(unsigned int initialSize);
+				// initialize an empty queue
+    ~RunQueue();		// de-allocate the queue
+
+    void Push(Thread *thread);	// put "thread" at the end (owner only)
+    void PushNext(Thread *thread);
+				// put "thread" in front of all the
+				// others (owner only)
+    Thread *Take();		// take the thread at the front off the
+				// queue; NULL if there isn't one
+    Thread *TakeLast();		// take the thread at the back off the
+				// queue, to steal it; NULL if there
+				// isn't one
+    void Remove(Thread *thread);
+				// take "thread" off the queue, from
+				// wherever it is
+
+    unsigned int Size();	// how many threads are on the queue?
+    bool IsEmpty() { return (Size() == 0); }
+    Thread *Item(unsigned int i);
+				// the i'th thread from the front
+
+  private:
+    Thread **buffer;		// the threads, from buffer[head] to
+				// buffer[tail - 1], modulo capacity
+    unsigned int capacity;	// size of "buffer"; a power of two
+    unsigned int head;		// index of the front of the queue
+    unsigned int tail;		// index just past the back
+    Thread *next;		// thread to run before those in
+				// buffer, or NULL
+
+    void Grow();		// double the size of the buffer
+};
+
+#endif // RUNQUEUE_H
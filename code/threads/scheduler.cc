@@ -11,8 +11,34 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	Two policies are implemented (see scheduler.h): straight FIFO,
+//	and a multi-level feedback queue.  The MLFQ keeps one FIFO list
+//	per priority level, and a bitmap of the levels that have ready
+//	threads, so picking the next thread doesn't depend on how many
+//	levels (or threads) there are.  SJF keeps the ready threads
+//	sorted by the predicted length of their next CPU burst, and
+//	STRIDE keeps them sorted by pass; LOTTERY uses the plain FIFO
+//	ready list, and walks it to find the winning ticket.  Ready
+//	real-time threads are kept apart, sorted by deadline, and are
+//	checked before any of these.
+//
+//	Every one of these queues is linked through the threads
+//	themselves (see Thread::queueLink), so making a thread ready
+//	and dispatching it never allocates memory, and a thread can be
+//	taken out of the middle of a queue in constant time.
+//
+//	With more than one CPU, the CPUs take turns: every dispatch is
+//	on the next CPU, which runs the thread at the front of its own
+//	run queue for the best priority waiting (FIFO), or of the shared
+//	ready queue.  The CPUs' run queues are plain circular buffers
+//	(see runqueue.h), with a mask per CPU of those that aren't
+//	empty: only their owners add to them, and when a CPU runs out
+//	of threads, it steals the last thread on another CPU's queue.
+//
+//	CPU time is measured in "busy" ticks (total ticks less idle
+//	ticks), so that time the machine spends idle, waiting for an
+//	interrupt before the next thread can be dispatched, isn't
+//	charged to the thread that was running before.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -21,17 +47,243 @@
 #include "copyright.h"
 #include "debug.h"
 #include "scheduler.h"
+#include "threadpool.h"
+#include "synch.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// BurstCompare
+//	Compare two threads by predicted CPU burst, for SJF.  Threads
+//	with the same prediction stay in FIFO order.
+//----------------------------------------------------------------------
+
+static int
+BurstCompare(Thread *x, Thread *y)
+{
+    if (x->predictedBurst < y->predictedBurst) { return -1; }
+    else if (x->predictedBurst > y->predictedBurst) { return 1; }
+    else { return 0; }
+}
+
+//----------------------------------------------------------------------
+// PassCompare
+//	Compare two threads by pass, for STRIDE.  Threads with the same
+//	pass stay in FIFO order.
+//----------------------------------------------------------------------
+
+static int
+PassCompare(Thread *x, Thread *y)
+{
+    if (x->pass < y->pass) { return -1; }
+    else if (x->pass > y->pass) { return 1; }
+    else { return 0; }
+}
+
+//----------------------------------------------------------------------
+// DeadlineCompare
+//	Compare two real-time threads by deadline, for EDF.  Threads
+//	with the same deadline stay in FIFO order.
+//----------------------------------------------------------------------
+
+static int
+DeadlineCompare(Thread *x, Thread *y)
+{
+    if (x->rtDeadline < y->rtDeadline) { return -1; }
+    else if (x->rtDeadline > y->rtDeadline) { return 1; }
+    else { return 0; }
+}
+
+//----------------------------------------------------------------------
+// BusyTicks
+//	Return how long the CPU has been busy running threads.
+//----------------------------------------------------------------------
+
+static int
+BusyTicks()
+{
+    return kernel->stats->totalTicks - kernel->stats->idleTicks;
+}
+
+//----------------------------------------------------------------------
+// CPU::CPU
+// 	Initialize a CPU, with nothing to run yet.
+//
+//	"cpuID" is the number of the CPU
+//----------------------------------------------------------------------
+
+CPU::CPU(int cpuID)
+{
+    id = cpuID;
+    for (int i = 0; i < NumPriorities; i++) {
+	runQueues[i] = new RunQueue(InitialRunQueueSize);
+    }
+    readyMask = 0;
+    busyTicks = 0;
+    numDispatches = 0;
+    numSteals = 0;
+    numMigrations = 0;
+}
+
+//----------------------------------------------------------------------
+// CPU::~CPU
+// 	De-allocate a CPU.
+//----------------------------------------------------------------------
+
+CPU::~CPU()
+{
+    for (int i = 0; i < NumPriorities; i++) {
+	delete runQueues[i];
+    }
+}
+
+//----------------------------------------------------------------------
+// CPU::Push
+// 	Put a thread on this CPU's run queue for its effective priority.
+//
+//	"thread" is the thread to be put on the queue
+//	"level" is its effective priority
+//	"atFront" is set if it should run before the threads already
+//		at that level
+//----------------------------------------------------------------------
+
+void
+CPU::Push(Thread *thread, int level, bool atFront)
+{
+    if (atFront) {
+	runQueues[level]->PushNext(thread);
+    } else {
+	runQueues[level]->Push(thread);
+    }
+    readyMask |= (1 << level);
+}
+
+//----------------------------------------------------------------------
+// CPU::Take
+// 	Take the thread at the front of this CPU's run queue for a
+//	priority off it, and return it.  There must be one.
+//
+//	"level" is the effective priority
+//----------------------------------------------------------------------
+
+Thread *
+CPU::Take(int level)
+{
+    Thread *thread = runQueues[level]->Take();
+
+    ASSERT(thread != NULL);
+    if (runQueues[level]->IsEmpty()) {
+	readyMask &= ~(1 << level);
+    }
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// CPU::TakeLast
+// 	Like Take, but take the thread at the back of the queue, for
+//	another CPU to steal (see runqueue.h).
+//
+//	"level" is the effective priority
+//----------------------------------------------------------------------
+
+Thread *
+CPU::TakeLast(int level)
+{
+    Thread *thread = runQueues[level]->TakeLast();
+
+    ASSERT(thread != NULL);
+    if (runQueues[level]->IsEmpty()) {
+	readyMask &= ~(1 << level);
+    }
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// CPU::Remove
+// 	Take a thread off this CPU's run queue for a priority, from
+//	wherever it is on the queue (because its priority is changing).
+//
+//	"thread" is the thread to take off the queue
+//	"level" is the priority it was queued at
+//----------------------------------------------------------------------
+
+void
+CPU::Remove(Thread *thread, int level)
+{
+    runQueues[level]->Remove(thread);
+    if (runQueues[level]->IsEmpty()) {
+	readyMask &= ~(1 << level);
+    }
+}
+
+//----------------------------------------------------------------------
+// CPUQuota::CPUQuota
+// 	Initialize the CPU quota of a user program, with its first
+//	period starting now.  The name is copied, since the program
+//	(and its name) may go away before the quota is reported.
+//
+//	"programName" is the name of the program
+//	"quotaPeriod" is the length of a period, in ticks
+//	"quotaBudget" is the CPU ticks it may use in each period
+//----------------------------------------------------------------------
+
+CPUQuota::CPUQuota(char *programName, int quotaPeriod, int quotaBudget)
+{
+    ASSERT(quotaPeriod > 0 && quotaBudget > 0 && quotaBudget <= quotaPeriod);
+    name = new char[strlen(programName) + 1];
+    strcpy(name, programName);
+    period = quotaPeriod;
+    budget = quotaBudget;
+    periodEnd = kernel->stats->totalTicks + period;
+    used = 0;
+    throttled = new ThreadQueue;
+    numThrottled = throttledTicks = 0;
+    throttledSince = -1;
+}
+
+//----------------------------------------------------------------------
+// CPUQuota::~CPUQuota
+// 	De-allocate a CPU quota.
+//----------------------------------------------------------------------
+
+CPUQuota::~CPUQuota()
+{
+    delete throttled;
+    delete [] name;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads.
 //	Initially, no ready threads.
+//
+//	"type" is the scheduling policy to use
+//	"numCPUs" is the number of CPUs to schedule threads on
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedulerType type, int numCPUs)
 { 
-    readyList = new List<Thread *>; 
+    ASSERT(numCPUs >= 1 && numCPUs <= MaxCPUs);
+    this->type = type;
+    this->numCPUs = numCPUs;
+    for (int i = 0; i < numCPUs; i++) {
+	cpus[i] = new CPU(i);
+    }
+    currentCPU = 0;
+    numQueued = 0;
+    readyList = new ThreadQueue; 
+    for (int i = 0; i < NumPriorities; i++) {
+	readyQueues[i] = new ThreadQueue;
+    }
+    readyMask = 0;
+    sjfList = new SortedThreadQueue(BurstCompare);
+    strideList = new SortedThreadQueue(PassCompare);
+    globalPass = 0;
+    edfList = new SortedThreadQueue(DeadlineCompare);
+    throttledList = new SortedThreadQueue(DeadlineCompare);
+    rtUtilization = 0;
+    quotas = new List<CPUQuota *>;
+    numQuotaThrottled = 0;
+    slicesSinceBoost = 0;
     toBeDestroyed = NULL;
 } 
 
@@ -42,7 +294,21 @@ Scheduler::Scheduler()
 
 Scheduler::~Scheduler()
 { 
+    for (int i = 0; i < numCPUs; i++) {
+	delete cpus[i];
+    }
     delete readyList; 
+    for (int i = 0; i < NumPriorities; i++) {
+	delete readyQueues[i];
+    }
+    delete sjfList;
+    delete strideList;
+    delete edfList;
+    delete throttledList;
+    while (!quotas->IsEmpty()) {
+	delete quotas->RemoveFront();
+    }
+    delete quotas;
 } 
 
 //----------------------------------------------------------------------
@@ -50,23 +316,123 @@ Scheduler::~Scheduler()
 // 	Mark a thread as ready, but not running.
 //	Put it on the ready list, for later scheduling onto the CPU.
 //
+//	Under MLFQ, a thread that was blocked (waiting for I/O, say)
+//	moves up a level when it becomes ready again.  Under PSJF, a
+//	thread that is expected to finish its burst sooner than the
+//	running thread preempts it.  Under STRIDE, a thread that was
+//	blocked (or is new) may not use the time it spent away to
+//	monopolize the CPU: its pass is brought up to that of the
+//	thread that was dispatched last.
+//
+//	A real-time thread goes on the EDF list, and preempts the
+//	running thread if that is a normal thread, or has a later
+//	deadline -- unless it has used up its budget, in which case it
+//	is throttled until its next period.  A real-time thread that
+//	wakes up after its deadline has passed starts a new period.
+//
+//	A normal thread whose program has used up its CPU quota is
+//	throttled until the program's next period.
+//
+//	Under FIFO, STRIDE and LOTTERY, a thread that wakes up with a
+//	short quantum (it usually blocks long before using up a time
+//	slice, as interactive threads do) cuts the running thread's
+//	time slice short; under FIFO, it also goes to the front of the
+//	ready list.
+//
+//	If the timer was off, because the running thread had the CPU
+//	to itself, it is turned back on.
+//
+//	If the running thread is yielding, its CPU burst ends here,
+//	rather than in Run, so that it is queued (under SJF or STRIDE)
+//	according to the CPU time it has just used.
+//
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
 
 void
 Scheduler::ReadyToRun (Thread *thread)
 {
+    bool interactive = (thread->getStatus() == BLOCKED && Adaptive()
+			&& !thread->isRealTime() && thread->quantum < TimerTicks);
+    bool throttle;
+
     ASSERT(kernel->interrupt->getLevel() == IntOff);
     DEBUG(dbgThread, "Putting thread on ready list: " << thread->getName());
 	//cout << "Putting thread on ready list: " << thread->getName() << endl ;
 
+    if (thread == kernel->currentThread) {
+	EndBurst(thread);
+    }
+
     /*********************************************/    
+    if ((type == MLFQ) && (thread->getStatus() == BLOCKED) 
+		&& (thread->getPriority() > 0)) {
+	thread->setPriority(thread->getPriority() - 1);
+	thread->slicesUsed = 0;
+	DEBUG(dbgThread, "Raising " << thread->getName() << " to level "
+					<< thread->getPriority());
+    }
+    if (thread->isRealTime() && (thread->getStatus() == JUST_CREATED
+		|| thread->getStatus() == BLOCKED)
+		&& (thread->rtDeadline <= kernel->stats->totalTicks)) {
+	NewPeriod(thread);
+    }
+    if ((type == STRIDE) && (thread->getStatus() == JUST_CREATED
+		|| thread->getStatus() == BLOCKED) && (thread->pass < globalPass)) {
+	thread->pass = globalPass;
+    }
     thread->setStatus(READY);
+    thread->readySince = kernel->stats->totalTicks;
     // 此時設定 thread 的 status 由 JUST_CREATED to READY    
     /*********************************************/
 
     /*********************************************/
-    readyList->Append(thread);
+    throttle = OverQuota(thread);
+    if (throttle) {
+	CPUQuota *quota = thread->quota;
+
+	DEBUG(dbgThread, "Throttling " << thread->getName()
+			<< " until " << quota->periodEnd);
+	if (quota->throttledSince < 0) {
+	    quota->throttledSince = kernel->stats->totalTicks;
+	    quota->numThrottled++;
+	}
+	quota->throttled->Append(thread);
+	numQuotaThrottled++;
+    } else if (thread->isRealTime()) {
+	if (thread->rtUsed >= thread->rtBudget) {
+	    DEBUG(dbgThread, "Throttling " << thread->getName() 
+			<< " until " << thread->rtDeadline);
+	    throttledList->Insert(thread);
+	} else {
+	    edfList->Insert(thread);
+	    if (RTPreempts(thread)) {
+		kernel->interrupt->YieldSoon();
+	    }
+	}
+    } else if (type == MLFQ) {
+	readyQueues[thread->getEffectivePriority()]->Append(thread);
+	readyMask |= (1 << thread->getEffectivePriority());
+    } else if (type == SJF || type == PSJF) {
+	sjfList->Insert(thread);
+	if (type == PSJF && ShouldPreempt(thread)) {
+	    DEBUG(dbgThread, thread->getName() << " preempts "
+				<< kernel->currentThread->getName());
+	    kernel->interrupt->YieldSoon();
+	}
+    } else if (type == STRIDE) {
+	strideList->Insert(thread);
+    } else if (type == FIFO) {
+	Enqueue(thread, interactive);
+    } else {
+	readyList->Append(thread);
+    }
+    if (interactive && !throttle) {
+	WakeInteractive(thread);
+    }
+    if (!kernel->alarm->SliceRunning()) {
+	ArmTimer(kernel->currentThread);	// someone to preempt for now
+    }
     // status 為 READY 的 thread 加入 readyList 中
     
     // cout << "In schduler::ReadyToRun \n\t";
@@ -78,7 +444,9 @@ Scheduler::ReadyToRun (Thread *thread)
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
-// 	Return the next thread to be scheduled onto the CPU.
+// 	Return the next thread to be scheduled onto the CPU: the ready
+//	real-time thread with the earliest deadline, if there is one,
+//	otherwise whatever the policy picks among the normal threads.
 //	If there are no ready threads, return NULL.
 // Side effect:
 //	Thread is removed from the ready list.
@@ -89,16 +457,184 @@ Scheduler::FindNextToRun ()
 {
     ASSERT(kernel->interrupt->getLevel() == IntOff);
 
-    if (readyList->IsEmpty()) {
-		return NULL;
-    } else {
-        // cout << "In Scheduler::FindNextToRun()" << endl; 
-        // cout << "\t";
-        // Print();
-        Thread *a = readyList->RemoveFront();
-        // cout << "\tNext = " << a->getName() << endl;
-    	return a;
+    if (!edfList->IsEmpty()) {
+	return edfList->RemoveFront();
+    }
+    if (type == MLFQ) {
+	int level;
+	Thread *thread;
+
+	if (readyMask == 0) {
+	    return NULL;
+	}
+	level = __builtin_ctz(readyMask);	// highest non-empty level
+	thread = readyQueues[level]->RemoveFront();
+	if (readyQueues[level]->IsEmpty()) {
+	    readyMask &= ~(1 << level);
+	}
+	return thread;
+    }
+    if (type == SJF || type == PSJF) {
+	if (sjfList->IsEmpty()) {
+	    return NULL;
+	}
+	return sjfList->RemoveFront();
+    }
+    if (type == STRIDE) {
+	Thread *thread;
+
+	if (strideList->IsEmpty()) {
+	    return NULL;
+	}
+	thread = strideList->RemoveFront();
+	globalPass = thread->pass;
+	return thread;
     }
+    if (type == LOTTERY) {
+	Thread *thread = DrawLottery(NULL);
+
+	if (thread != NULL) {
+	    readyList->Remove(thread);
+	}
+	return thread;
+    }
+
+    return Dequeue();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Enqueue
+// 	Put a thread on the run queue of the current CPU -- the only
+//	queue we may add to (see runqueue.h).  That is where a thread
+//	that yields or is preempted was running anyway; a new thread,
+//	or one that wakes up, starts out on the CPU of the thread that
+//	made it ready, and moves if another CPU runs out of work.
+//
+//	"thread" is the thread to be put on a run queue
+//	"atFront" is set if it should run before the threads already
+//		on the queue at its priority
+//----------------------------------------------------------------------
+
+void
+Scheduler::Enqueue(Thread *thread, bool atFront)
+{
+    CPU *cpu = cpus[currentCPU];
+
+    Migrate(thread, cpu);
+    thread->queuedLevel = thread->getEffectivePriority();
+    cpu->Push(thread, thread->queuedLevel, atFront);
+    numQueued++;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Dequeue
+// 	Find the most important threads waiting on any CPU, and return
+//	the one at the front of the run queue of the next CPU (after the
+//	current one) that has one, taking it off the queue.  A CPU with
+//	nothing waiting at all tries to steal one from another CPU
+//	instead.  If there are no threads waiting on any CPU, return
+//	NULL.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::Dequeue()
+{
+    CPU *cpu;
+    Thread *thread = NULL;
+    int level;
+
+    if (numQueued == 0) {
+	return NULL;
+    }
+    level = BestQueuedLevel();
+    for (int i = 1; i <= numCPUs && thread == NULL; i++) {
+	cpu = cpus[(currentCPU + i) % numCPUs];
+	if (cpu->readyMask & (1 << level)) {
+	    thread = cpu->Take(level);
+	} else if (cpu->readyMask == 0) {
+	    thread = Steal(cpu, level);
+	}
+    }
+    ASSERT(thread != NULL);		// some CPU has one at "level"
+    numQueued--;
+    thread->queuedLevel = -1;
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::BestQueuedLevel
+// 	Return the best (lowest) effective priority among the threads on
+//	the CPUs' run queues, or NumPriorities if there are none.
+//----------------------------------------------------------------------
+
+int
+Scheduler::BestQueuedLevel()
+{
+    unsigned int mask = 0;
+
+    for (int i = 0; i < numCPUs; i++) {
+	mask |= cpus[i]->readyMask;
+    }
+    if (mask == 0) {
+	return NumPriorities;
+    }
+    return __builtin_ctz(mask);		// highest non-empty level
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Steal
+// 	A CPU has nothing to run; take a thread from the back of the
+//	longest run queue for a priority, if that has more than one
+//	thread waiting.
+//	(A CPU with just one will run it on its own next turn, and the
+//	thread would only lose its registers by moving.)  Return the
+//	thread, or NULL if there is nothing worth stealing.
+//
+//	"thief" is the CPU with nothing to run
+//	"level" is the priority of the most important waiting threads
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::Steal(CPU *thief, int level)
+{
+    CPU *victim = NULL;
+    Thread *thread;
+
+    for (int i = 0; i < numCPUs; i++) {
+	if (cpus[i] != thief && cpus[i]->runQueues[level]->Size() > 1
+		&& (victim == NULL
+		    || cpus[i]->runQueues[level]->Size()
+			> victim->runQueues[level]->Size())) {
+	    victim = cpus[i];
+	}
+    }
+    if (victim == NULL) {
+	return NULL;
+    }
+    thread = victim->TakeLast(level);	// not the one to run next
+    DEBUG(dbgThread, "cpu " << thief->id << " steals "
+		<< thread->getName() << " from cpu " << victim->id);
+    thief->numSteals++;
+    Migrate(thread, thief);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Migrate
+// 	Record that a thread is to run on a CPU, counting it as a
+//	migration if it has run (or been queued) somewhere else.
+//
+//	"thread" is the thread
+//	"cpu" is where it is going
+//----------------------------------------------------------------------
+
+void
+Scheduler::Migrate(Thread *thread, CPU *cpu)
+{
+    if (thread->cpu >= 0 && thread->cpu != cpu->id) {
+	cpu->numMigrations++;
+    }
+    thread->cpu = cpu->id;
 }
 
 //----------------------------------------------------------------------
@@ -137,11 +673,18 @@ Scheduler::Run (Thread *nextThread, bool finishing)
     // 用 toBeDestroyed 指到他，等下會做 delete
     /********************************************/
 
+    EndBurst(oldThread);		// the old thread's CPU burst is over
+    if (!finishing && oldThread->preempted) {
+	oldThread->account.involuntarySwitches++;	// timer, or a more
+    } else if (!finishing) {				// important thread
+	oldThread->account.voluntarySwitches++;	// it waits, or yields
+    }
+
     /********************************************/
     if (oldThread->space != NULL) {	// if this thread is a user program,
-        oldThread->SaveUserState(); 	// save the user's CPU registers
-	    oldThread->space->SaveState();
-    }
+	oldThread->space->SaveState();	// its CPU registers stay in the
+    }					// machine until someone else
+					// needs them (see RestoreUserState)
     // 若 process 還沒完成，則會將 thread 資訊儲存起來
     /********************************************/
 
@@ -153,6 +696,17 @@ Scheduler::Run (Thread *nextThread, bool finishing)
     kernel->currentThread = nextThread;  // switch to the next thread
     // 將下一個要跑 thread 放到 CPU
     nextThread->setStatus(RUNNING);      // nextThread is now running
+    nextThread->burstStart = BusyTicks();
+    nextThread->userInstrs = 0;
+    nextThread->account.RecordLatency(kernel->stats->totalTicks
+					- nextThread->readySince);
+    if (!PerCPU(nextThread)) {		// from a shared queue: it is
+	Migrate(nextThread, cpus[(currentCPU + 1) % numCPUs]);	// the
+    }					// next CPU's turn
+    currentCPU = nextThread->cpu;
+    cpus[currentCPU]->numDispatches++;
+    kernel->machine->SelectCPU(currentCPU);
+    ArmTimer(nextThread);
     // 將 Thread 的 status 設為 RUNNING
     /********************************************/
     DEBUG(dbgThread, "Switching from: " << oldThread->getName() << " to: " << nextThread->getName());
@@ -207,28 +761,889 @@ Scheduler::Run (Thread *nextThread, bool finishing)
     /**********************************************/
     
     if (oldThread->space != NULL) {	    // if there is an address space
-        oldThread->RestoreUserState();     // to restore, do it.
-	oldThread->space->RestoreState();
+        oldThread->RestoreUserState();     // to restore, do it -- unless
+	oldThread->space->RestoreState();  // it is still loaded
     }
 }
 
 //----------------------------------------------------------------------
 // Scheduler::CheckToBeDestroyed
 // 	If the old thread gave up the processor because it was finishing,
-// 	we need to delete its carcass.  Note we cannot delete the thread
+// 	we need to get rid of its carcass.  Note we cannot do so
 // 	before now (for example, in Thread::Finish()), because up to this
 // 	point, we were still running on the old thread's stack!
+//
+//	The thread (and its stack) goes back to the kernel's thread
+//	pool, to be reused by the next thread that is created.
 //----------------------------------------------------------------------
 
 void
 Scheduler::CheckToBeDestroyed()
 {
     if (toBeDestroyed != NULL) {
-        delete toBeDestroyed;
+        kernel->threadPool->Put(toBeDestroyed);
 	toBeDestroyed = NULL;
     }
 }
  
+//----------------------------------------------------------------------
+// Scheduler::SliceExpired
+// 	Called by the timer interrupt handler (Alarm::CallBack), to
+//	decide whether the running thread should be preempted.
+//
+//	A real-time thread is preempted when it has used up its budget
+//	for this period, or a real-time thread with an earlier deadline
+//	is ready; a normal thread is preempted whenever a real-time
+//	thread is ready, or its program has used up its CPU quota.
+//	Otherwise, it depends on the policy.
+//
+//	Under FIFO, STRIDE and LOTTERY, the timer goes off when the
+//	thread's quantum is up (see TimeSlice); if it has run for its
+//	whole quantum, it is taken to be CPU-bound, and its quantum is
+//	doubled, so that it is switched out less often.
+//
+//	Under FIFO, the answer is always yes (round robin); under SJF
+//	and PSJF, it is always no (a burst runs until the thread
+//	blocks or yields, or PSJF preempts it).  Under STRIDE, the
+//	thread keeps the CPU until its pass overtakes that of the
+//	first ready thread.  Under LOTTERY, a lottery is held among
+//	the running and ready threads, and the thread is preempted
+//	if it loses (the winner among the rest is drawn by
+//	FindNextToRun, which gives every thread the right odds).  Under
+//	MLFQ, a thread at level L may run through 2^L timer interrupts
+//	before it is preempted and demoted to the next level down; it
+//	is also preempted early if a thread at a higher level than its
+//	effective one (see Scheduler::Reprioritize) is ready.
+//	Every so often, all threads are boosted back to the top level.
+//
+//	"thread" is the thread that was running when the timer went off
+//----------------------------------------------------------------------
+
+bool
+Scheduler::SliceExpired(Thread *thread)
+{
+    int level = thread->getPriority();
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    if (thread->isRealTime()) {
+	if (RTUsed(thread) >= thread->rtBudget) {
+	    return TRUE;		// ReadyToRun will throttle it
+	}
+	return (!edfList->IsEmpty() 
+		&& edfList->Front()->rtDeadline < thread->rtDeadline);
+    }
+    if (!edfList->IsEmpty()) {
+	return TRUE;
+    }
+    if (OverQuota(thread)) {
+	return TRUE;			// Yield will throttle it
+    }
+
+    if (Adaptive() && BusyTicks() - thread->burstStart >= thread->quantum
+		&& thread->quantum < MaxQuantum) {
+	thread->quantum = min(thread->quantum * 2, MaxQuantum);
+	DEBUG(dbgThread, "Lengthening quantum of " << thread->getName() 
+			<< " to " << thread->quantum);
+    }
+    if (type == FIFO) {			// unless it is more important
+	return (BestQueuedLevel() <= thread->getEffectivePriority());
+    } else if (type == SJF || type == PSJF) {
+	return FALSE;			// bursts run to completion
+    } else if (type == STRIDE) {
+	return (!strideList->IsEmpty()
+		&& CurrentPass(thread) > strideList->Front()->pass);
+    } else if (type == LOTTERY) {
+	return (DrawLottery(thread) != thread);
+    }
+
+    if (++slicesSinceBoost >= MLFQBoostSlices) {
+	slicesSinceBoost = 0;
+	Boost();
+	thread->setPriority(0);
+	thread->slicesUsed = 0;
+	return (readyMask != 0);
+    }
+    if (++thread->slicesUsed >= Quantum(level)) {
+	thread->slicesUsed = 0;
+	if (level < NumPriorities - 1) {
+	    thread->setPriority(level + 1);
+	    DEBUG(dbgThread, "Lowering " << thread->getName() << " to level "
+					<< level + 1);
+	}
+	return TRUE;
+    }
+    return ((readyMask & ((1 << thread->getEffectivePriority()) - 1)) != 0);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ArmTimer
+// 	Set the (one-shot) timer to go off when the scheduler next
+//	needs to look at a thread -- or turn it off, if a timer
+//	interrupt can't change anything.  Called when a thread is
+//	dispatched, and on every timer interrupt.
+//
+//	"thread" is the thread about to run (or running); if it isn't
+//		running, we are idle
+//----------------------------------------------------------------------
+
+void
+Scheduler::ArmTimer(Thread *thread)
+{
+    if (NeedsTimer(thread)) {
+	kernel->alarm->StartSlice(TimeSlice(thread));
+    } else {
+	kernel->alarm->StopSlices();
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NeedsTimer
+// 	Return TRUE if a timer interrupt could make a difference while
+//	"thread" runs: there are real-time deadlines to watch, or
+//	budgets or quotas to enforce, or throttled threads to let run
+//	again, or another thread is ready that preemption could let
+//	run.  SJF and PSJF never time-slice.
+//
+//	"thread" is the thread about to run (or running); if it isn't
+//		running, we are idle
+//----------------------------------------------------------------------
+
+bool
+Scheduler::NeedsTimer(Thread *thread)
+{
+    if (!edfList->IsEmpty() || !throttledList->IsEmpty()
+		|| numQuotaThrottled > 0) {
+	return TRUE;
+    }
+    if (thread->getStatus() != RUNNING) {
+	return FALSE;			// idle; nothing to preempt
+    }
+    if (thread->isRealTime() || thread->quota != NULL) {
+	return TRUE;
+    }
+    switch (type) {
+      case MLFQ:
+	return (readyMask != 0);
+      case SJF:
+      case PSJF:
+	return FALSE;
+      case STRIDE:
+	return !strideList->IsEmpty();
+      case FIFO:
+	return (numQueued > 0);
+      default:
+	return !readyList->IsEmpty();
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::TimeSlice
+// 	Return how long the timer should let a thread run before it
+//	interrupts again.  For a thread under FIFO, STRIDE or LOTTERY,
+//	that is its quantum; for a real-time thread, what is left of
+//	its budget (or period).  Otherwise (MLFQ, which counts timer
+//	interrupts, and SJF), it is TimerTicks.  A thread whose program
+//	has a CPU quota runs no longer than what is left of the quota.
+//
+//	Either way, the timer has to go off when the next real-time
+//	thread's deadline passes, to start its next period, and when
+//	the period of a throttled program ends.
+//
+//	"thread" is the thread about to run (or running); if it isn't
+//		running, we are idle
+//----------------------------------------------------------------------
+
+int
+Scheduler::TimeSlice(Thread *thread)
+{
+    int now = kernel->stats->totalTicks;
+    int slice = TimerTicks;
+
+    if (thread->getStatus() == RUNNING) {
+	if (thread->isRealTime()) {
+	    slice = thread->rtBudget - RTUsed(thread);
+	    if (slice <= 0) {		// overrunning, since nothing else
+		slice = TimerTicks;	// wants the CPU
+	    }
+	    slice = min(slice, thread->rtDeadline - now);
+	} else if (Adaptive()) {
+	    slice = thread->quantum;
+	}
+	if (!thread->isRealTime() && thread->quota != NULL) {
+	    slice = min(slice, thread->quota->budget - QuotaUsed(thread));
+	}
+    }
+    if (!edfList->IsEmpty()) {
+	slice = min(slice, edfList->Front()->rtDeadline - now);
+    }
+    if (!throttledList->IsEmpty()) {
+	slice = min(slice, throttledList->Front()->rtDeadline - now);
+    }
+    if (numQuotaThrottled > 0) {
+	for (ListIterator<CPUQuota *> iter(quotas); !iter.IsDone();
+							iter.Next()) {
+	    if (!iter.Item()->throttled->IsEmpty()) {
+		slice = min(slice, iter.Item()->periodEnd - now);
+	    }
+	}
+    }
+    return max(slice, 1);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::WakeInteractive
+// 	An interactive thread (one with a short quantum) just woke up.
+//	If the running thread has a longer quantum, cut its time slice
+//	short, so that the woken thread doesn't have to wait long.
+//
+//	"thread" is the thread that just woke up
+//----------------------------------------------------------------------
+
+void
+Scheduler::WakeInteractive(Thread *thread)
+{
+    Thread *running = kernel->currentThread;
+
+    if (running != thread && running->getStatus() == RUNNING
+		&& !running->isRealTime() && running->quantum > thread->quantum) {
+	DEBUG(dbgThread, thread->getName() << " cuts short the time slice of "
+			<< running->getName());
+	kernel->alarm->CutSlice(MinQuantum);
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Reprioritize
+// 	Change the priority a thread has been donated by the threads
+//	waiting for locks it holds (see Lock::Acquire).  Under FIFO and
+//	MLFQ, a thread is queued and preempted according to its
+//	effective priority -- the better of its own priority and the
+//	donated one -- so that a thread holding a lock runs ahead of
+//	threads less important than those waiting for it.  If the
+//	thread is ready, it moves to its new level.  If it is running,
+//	and its priority has dropped below that of a ready thread, it
+//	yields.
+//
+//	SJF, STRIDE and LOTTERY order threads by other measures, and
+//	ignore priorities; Lock doesn't donate under them (see
+//	HonorsPriority).
+//
+//	"thread" is the thread whose priority changes
+//	"donated" is its new donated priority, NumPriorities if none
+//----------------------------------------------------------------------
+
+void
+Scheduler::Reprioritize(Thread *thread, int donated)
+{
+    int oldLevel = thread->getEffectivePriority();
+    int level;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    if (!HonorsPriority()) {
+	return;
+    }
+    thread->donatedPriority = donated;
+    level = thread->getEffectivePriority();
+    if (thread->isRealTime() || level == oldLevel) {
+	return;
+    }
+    DEBUG(dbgThread, "Moving " << thread->getName() << " from level "
+		<< oldLevel << " to level " << level);
+    if (type == FIFO) {
+	if (thread->queuedLevel >= 0) {		// on a run queue
+	    cpus[thread->cpu]->Remove(thread, thread->queuedLevel);
+	    cpus[thread->cpu]->Push(thread, level, FALSE);
+	    thread->queuedLevel = level;
+	} else if (thread == kernel->currentThread
+		&& BestQueuedLevel() < level) {
+	    kernel->interrupt->YieldSoon();
+	}
+    } else if (thread->getStatus() == READY) {
+	readyQueues[oldLevel]->Remove(thread);
+	if (readyQueues[oldLevel]->IsEmpty()) {
+	    readyMask &= ~(1 << oldLevel);
+	}
+	readyQueues[level]->Append(thread);
+	readyMask |= (1 << level);
+    } else if (thread == kernel->currentThread
+		&& (readyMask & ((1 << level) - 1)) != 0) {
+	kernel->interrupt->YieldSoon();
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Boost
+// 	Move every ready thread to the top MLFQ level.  (No thread can
+//	be donated a higher priority than that, so no thread stays
+//	behind.)
+//----------------------------------------------------------------------
+
+void
+Scheduler::Boost()
+{
+    Thread *thread;
+
+    DEBUG(dbgThread, "Boosting all ready threads to level 0");
+    for (int level = 1; level < NumPriorities; level++) {
+	while (!readyQueues[level]->IsEmpty()) {
+	    thread = readyQueues[level]->RemoveFront();
+	    thread->setPriority(0);
+	    thread->slicesUsed = 0;
+	    readyQueues[0]->Append(thread);
+	}
+    }
+    if (readyMask != 0) {
+	readyMask = 1;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::EndBurst
+// 	A thread is giving up the CPU (it yielded, blocked, finished,
+//	or was preempted), which ends its CPU burst.  Fold the length
+//	of the burst into its prediction of the next one (exponential
+//	averaging), and charge it to the thread's CPU time and pass.
+//	If the thread is blocking, and used less than half its quantum,
+//	it is taken to be interactive, and its quantum is halved.
+//
+//	The burst also counts against the CPU quota of the thread's
+//	program, if it has one.
+//
+//	Does nothing if the burst has already ended (a yielding thread
+//	ends its burst in ReadyToRun, before Run gets to it).
+//
+//	"thread" is the thread giving up the CPU
+//----------------------------------------------------------------------
+
+void
+Scheduler::EndBurst(Thread *thread)
+{
+    int burst;
+
+    if (thread->burstStart < 0) {
+	return;
+    }
+    burst = BusyTicks() - thread->burstStart;
+    thread->burstStart = -1;
+    thread->cpuTicks += burst;
+    if (thread->isRealTime()) {
+	thread->rtUsed += burst;	// counts against its budget
+    }
+    if (thread->quota != NULL) {
+	thread->quota->used += burst;
+    }
+    if (thread->cpu >= 0) {
+	cpus[thread->cpu]->busyTicks += burst;
+    }
+    thread->pass += (double) StrideScale / thread->getTickets()
+				* burst / TimerTicks;
+    thread->predictedBurst = SJFAlpha * burst 
+				+ (1 - SJFAlpha) * thread->predictedBurst;
+    if (thread->getStatus() == BLOCKED && burst < thread->quantum / 2
+		&& thread->quantum > MinQuantum) {
+	thread->quantum = max(thread->quantum / 2, MinQuantum);
+    }
+    DEBUG(dbgThread, thread->getName() << " ran for " << burst
+		<< " ticks, next burst predicted " << thread->predictedBurst);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ShouldPreempt
+// 	Return TRUE if a thread that just became ready is predicted to
+//	finish its burst before the running thread finishes what is
+//	left of its own.
+//
+//	"thread" is the thread that just became ready
+//----------------------------------------------------------------------
+
+bool
+Scheduler::ShouldPreempt(Thread *thread)
+{
+    Thread *running = kernel->currentThread;
+    int elapsed;
+
+    if (thread == running || running->getStatus() != RUNNING) {
+	return FALSE;		// it's us yielding, or we're about to
+				// give up the CPU anyway
+    }
+    if (running->isRealTime()) {
+	return FALSE;		// normal threads never preempt these
+    }
+    elapsed = BusyTicks() - running->burstStart;
+    return (thread->predictedBurst < running->predictedBurst - elapsed);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::CurrentPass
+// 	Return the pass of a thread, including the charge for the
+//	burst it is in the middle of, if it is running.
+//
+//	"thread" is the thread to look at
+//----------------------------------------------------------------------
+
+double
+Scheduler::CurrentPass(Thread *thread)
+{
+    if (thread->burstStart < 0) {
+	return thread->pass;
+    }
+    return thread->pass + (double) StrideScale / thread->getTickets()
+			* (BusyTicks() - thread->burstStart) / TimerTicks;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::DrawLottery
+// 	Hold a lottery among the ready threads, and (if it isn't NULL)
+//	the running thread; each holds as many chances as it has
+//	tickets.  Return the winner, or NULL if there are no threads.
+//	The winner is left where it is.
+//
+//	"running" is the running thread, or NULL to draw only among
+//	the ready threads
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::DrawLottery(Thread *running)
+{
+    ThreadQueueIterator iter(readyList);
+    int total = 0;
+    int winner;
+
+    if (running != NULL) {
+	total = running->getTickets();
+    }
+    for (; !iter.IsDone(); iter.Next()) {
+	total += iter.Item()->getTickets();
+    }
+    if (total == 0) {
+	return NULL;
+    }
+
+    winner = RandomNumber() % total;
+    if (running != NULL) {
+	if (winner < running->getTickets()) {
+	    return running;
+	}
+	winner -= running->getTickets();
+    }
+    for (ThreadQueueIterator pick(readyList); ; pick.Next()) {
+	if (winner < pick.Item()->getTickets()) {
+	    return pick.Item();
+	}
+	winner -= pick.Item()->getTickets();
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetRealTime
+// 	Move a thread into the real-time class, with a new period and
+//	budget, or back to the normal class if "period" is 0.  Its
+//	first period starts now.
+//
+//	A thread is only admitted if the CPU can still meet every
+//	real-time thread's deadlines, which under EDF means the
+//	budgets must add up to no more than the whole CPU.  Returns
+//	FALSE (and leaves the thread alone) if not, or if the
+//	parameters make no sense.
+//
+//	"thread" is the running thread, or one that hasn't been
+//		Fork'ed yet
+//	"period" is the length of a period, in ticks
+//	"budget" is the CPU ticks it needs in each period
+//----------------------------------------------------------------------
+
+bool
+Scheduler::SetRealTime(Thread *thread, int period, int budget)
+{
+    double oldShare = 0;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    ASSERT(thread == kernel->currentThread
+		|| thread->getStatus() == JUST_CREATED);
+    if (thread->isRealTime()) {
+	oldShare = (double) thread->rtBudget / thread->rtPeriod;
+    }
+    rtUtilization -= oldShare;		// its old reservation can be reused
+    if (!CanAdmit(period, budget)) {
+	rtUtilization += oldShare;
+	DEBUG(dbgThread, "Can't admit " << thread->getName()
+		<< ": " << rtUtilization << " of the CPU already reserved");
+	return FALSE;
+    }
+    if (period > 0) {
+	rtUtilization += (double) budget / period;
+    }
+
+    if (thread == kernel->currentThread) {
+	EndBurst(thread);		// what it has run so far doesn't
+	thread->burstStart = BusyTicks();	// count against the budget
+    }
+    thread->rtPeriod = period;
+    thread->rtBudget = budget;
+    thread->rtDeadline = kernel->stats->totalTicks + period;
+    thread->rtUsed = 0;
+    DEBUG(dbgThread, thread->getName() << " is real-time: period " << period
+		<< ", budget " << budget);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::CanAdmit
+// 	Return TRUE if a period and budget make sense, and there is
+//	enough of the CPU left to reserve the budget in every period.
+//	A period of 0 (the normal class) is always admitted.
+//
+//	"period" is the length of a period, in ticks
+//	"budget" is the CPU ticks needed in each period
+//----------------------------------------------------------------------
+
+bool
+Scheduler::CanAdmit(int period, int budget)
+{
+    if (period < 0 || (period > 0 && (budget <= 0 || budget > period))) {
+	return FALSE;
+    }
+    return (period == 0 
+		|| rtUtilization + (double) budget / period <= 1 + 1e-9);
+}					// (allowing for rounding)
+
+//----------------------------------------------------------------------
+// Scheduler::CheckDeadlines
+// 	Called on every timer interrupt.  Every real-time thread that
+//	is still runnable when its deadline passes has either missed
+//	the deadline (if it hasn't received its budget) or overrun its
+//	budget (if it has, and still wanted more); either way, it
+//	starts a new period with a fresh budget.  Throttled threads
+//	become ready again this way.
+//
+//	Since the EDF and throttled lists are sorted by deadline, we
+//	only look at the threads whose deadline has actually passed.
+//----------------------------------------------------------------------
+
+void
+Scheduler::CheckDeadlines()
+{
+    int now = kernel->stats->totalTicks;
+    Thread *running = kernel->currentThread;
+    ThreadQueue passed;
+    Thread *thread;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    while (!edfList->IsEmpty() && edfList->Front()->rtDeadline <= now) {
+	passed.Append(edfList->RemoveFront());
+    }
+    while (!throttledList->IsEmpty()
+		&& throttledList->Front()->rtDeadline <= now) {
+	passed.Append(throttledList->RemoveFront());
+    }
+    if (running->isRealTime() && running->getStatus() == RUNNING
+		&& running->rtDeadline <= now) {
+	passed.Append(running);
+    }
+
+    while (!passed.IsEmpty()) {
+	thread = passed.RemoveFront();
+	if (RTUsed(thread) < thread->rtBudget) {
+	    thread->deadlineMisses++;
+	    DEBUG(dbgThread, thread->getName() << " missed its deadline");
+	} else {
+	    thread->budgetOverruns++;
+	}
+	NewPeriod(thread);
+	if (thread != running) {
+	    edfList->Insert(thread);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NewPeriod
+// 	Start the next period of a real-time thread (skipping any that
+//	have gone by entirely), with a fresh budget.  If the thread is
+//	running, only what it runs from now on counts against the new
+//	budget.
+//
+//	"thread" is a real-time thread whose deadline has passed
+//----------------------------------------------------------------------
+
+void
+Scheduler::NewPeriod(Thread *thread)
+{
+    int now = kernel->stats->totalTicks;
+
+    if (thread == kernel->currentThread && thread->burstStart >= 0) {
+	EndBurst(thread);
+	thread->burstStart = BusyTicks();
+    }
+    while (thread->rtDeadline <= now) {
+	thread->rtDeadline += thread->rtPeriod;
+	thread->rtPeriods++;
+    }
+    thread->rtUsed = 0;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::RTUsed
+// 	Return how much of its budget a real-time thread has used in
+//	the current period, including the burst it is running now.
+//
+//	"thread" is a real-time thread
+//----------------------------------------------------------------------
+
+int
+Scheduler::RTUsed(Thread *thread)
+{
+    if (thread == kernel->currentThread && thread->burstStart >= 0) {
+	return thread->rtUsed + BusyTicks() - thread->burstStart;
+    }
+    return thread->rtUsed;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::RTPreempts
+// 	Return TRUE if a real-time thread that just became ready should
+//	preempt the running thread.
+//
+//	"thread" is the real-time thread that just became ready
+//----------------------------------------------------------------------
+
+bool
+Scheduler::RTPreempts(Thread *thread)
+{
+    Thread *running = kernel->currentThread;
+
+    if (thread == running || running->getStatus() != RUNNING) {
+	return FALSE;
+    }
+    return (!running->isRealTime() || thread->rtDeadline < running->rtDeadline);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NewQuota
+// 	Return a new CPU quota for a user program; its threads are to
+//	point to it.  The scheduler keeps every quota until Nachos
+//	halts, to report how often it throttled its program.
+//
+//	"name" is the name of the program
+//	"period" is the length of a period, in ticks
+//	"budget" is the CPU ticks the program may use in each period
+//----------------------------------------------------------------------
+
+CPUQuota *
+Scheduler::NewQuota(char *name, int period, int budget)
+{
+    CPUQuota *quota = new CPUQuota(name, period, budget);
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    DEBUG(dbgThread, name << " has a CPU quota of " << budget
+		<< " ticks every " << period);
+    quotas->Append(quota);
+    return quota;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::OverQuota
+// 	Return TRUE if a normal thread's program has a CPU quota, and
+//	has used it up for the current period (counting the burst the
+//	thread is running now, if it is running).  If the period has
+//	ended, a new one starts first.
+//
+//	"thread" is the thread to check
+//----------------------------------------------------------------------
+
+bool
+Scheduler::OverQuota(Thread *thread)
+{
+    CPUQuota *quota = thread->quota;
+
+    if (quota == NULL || thread->isRealTime()) {
+	return FALSE;
+    }
+    if (quota->periodEnd <= kernel->stats->totalTicks) {
+	NewQuotaPeriod(quota);
+    }
+    return (QuotaUsed(thread) >= quota->budget);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::CheckQuotas
+// 	Called on every timer interrupt.  Every program that has been
+//	throttled, and whose period has ended, starts a new period, so
+//	that its threads can run again.  (Other programs start a new
+//	period the next time their quota is checked.)
+//----------------------------------------------------------------------
+
+void
+Scheduler::CheckQuotas()
+{
+    int now = kernel->stats->totalTicks;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    if (numQuotaThrottled == 0) {
+	return;
+    }
+    for (ListIterator<CPUQuota *> iter(quotas); !iter.IsDone(); iter.Next()) {
+	if (!iter.Item()->throttled->IsEmpty()
+			&& iter.Item()->periodEnd <= now) {
+	    NewQuotaPeriod(iter.Item());
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NewQuotaPeriod
+// 	Start the next period of a CPU quota (skipping any that have
+//	gone by entirely), with a fresh budget, and make the threads it
+//	throttled ready again.  If one of the program's threads is
+//	running, only what it runs from now on counts against the new
+//	budget.
+//
+//	"quota" is a quota whose period has ended
+//----------------------------------------------------------------------
+
+void
+Scheduler::NewQuotaPeriod(CPUQuota *quota)
+{
+    int now = kernel->stats->totalTicks;
+    Thread *running = kernel->currentThread;
+
+    if (running->quota == quota && running->burstStart >= 0) {
+	EndBurst(running);
+	running->burstStart = BusyTicks();
+    }
+    while (quota->periodEnd <= now) {
+	quota->periodEnd += quota->period;
+    }
+    quota->used = 0;
+    if (quota->throttledSince >= 0) {
+	quota->throttledTicks += now - quota->throttledSince;
+	quota->throttledSince = -1;
+    }
+    while (!quota->throttled->IsEmpty()) {
+	numQuotaThrottled--;
+	ReadyToRun(quota->throttled->RemoveFront());
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::QuotaUsed
+// 	Return how much of its CPU quota a thread's program has used in
+//	the current period, including the burst the thread is running
+//	now.  (No other thread of the program can be running at the
+//	same time, since the CPUs take turns.)
+//
+//	"thread" is a thread whose program has a quota
+//----------------------------------------------------------------------
+
+int
+Scheduler::QuotaUsed(Thread *thread)
+{
+    if (thread == kernel->currentThread && thread->burstStart >= 0) {
+	return thread->quota->used + BusyTicks() - thread->burstStart;
+    }
+    return thread->quota->used;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::RecordThread
+// 	Report a thread's statistics, printed at Halt: its CPU share
+//	under STRIDE or LOTTERY, and its deadline record if it is a
+//	real-time thread.
+//
+//	"thread" is the thread to report on
+//----------------------------------------------------------------------
+
+void
+Scheduler::RecordThread(Thread *thread)
+{
+    if (type == STRIDE || type == LOTTERY) {
+	kernel->stats->RecordShare(thread->getName(), thread->getTickets(),
+					thread->cpuTicks);
+    }
+    if (thread->isRealTime()) {
+	kernel->stats->RecordDeadlines(thread->getName(), thread->rtPeriods,
+			thread->deadlineMisses, thread->budgetOverruns);
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Retire
+// 	A thread has finished: report its statistics, and give back the
+//	share of the CPU it had reserved, if it was a real-time thread.
+//
+//	"thread" is the finished thread
+//----------------------------------------------------------------------
+
+void
+Scheduler::Retire(Thread *thread)
+{
+    RecordThread(thread);
+    if (thread->isRealTime()) {
+	rtUtilization -= (double) thread->rtBudget / thread->rtPeriod;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::RecordThreads
+// 	Nachos is halting: report the statistics of the running thread
+//	and of every ready (or throttled) thread.  (Finished threads
+//	were reported by Retire; threads that are blocked are not
+//	reported.)  If there is more than one CPU, also report how
+//	busy each of them was.  Report how often, and for how long,
+//	each CPU quota throttled its program.
+//----------------------------------------------------------------------
+
+void
+Scheduler::RecordThreads()
+{
+    ThreadQueue *lists[] = { readyList, sjfList, strideList,
+					edfList, throttledList };
+
+    EndBurst(kernel->currentThread);
+    RecordThread(kernel->currentThread);
+    for (unsigned int i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+	for (ThreadQueueIterator iter(lists[i]); !iter.IsDone();
+							iter.Next()) {
+	    RecordThread(iter.Item());
+	}
+    }
+    for (int level = 0; level < NumPriorities; level++) {
+	for (ThreadQueueIterator iter(readyQueues[level]); !iter.IsDone();
+							iter.Next()) {
+	    RecordThread(iter.Item());
+	}
+    }
+    for (int i = 0; i < numCPUs; i++) {
+	for (int level = 0; level < NumPriorities; level++) {
+	    RunQueue *queue = cpus[i]->runQueues[level];
+
+	    for (unsigned int j = 0; j < queue->Size(); j++) {
+		RecordThread(queue->Item(j));
+	    }
+	}
+	if (numCPUs > 1) {
+	    kernel->stats->RecordCPU(i, cpus[i]->busyTicks,
+			cpus[i]->numDispatches, cpus[i]->numSteals,
+			cpus[i]->numMigrations);
+	}
+    }
+    for (ListIterator<CPUQuota *> iter(quotas); !iter.IsDone(); iter.Next()) {
+	CPUQuota *quota = iter.Item();
+
+	for (ThreadQueueIterator t(quota->throttled); !t.IsDone(); t.Next()) {
+	    RecordThread(t.Item());
+	}
+	if (quota->throttledSince >= 0) {
+	    quota->throttledTicks += kernel->stats->totalTicks
+						- quota->throttledSince;
+	    quota->throttledSince = -1;
+	}
+	kernel->stats->RecordQuota(quota->name, quota->period,
+			quota->budget, quota->numThrottled,
+			quota->throttledTicks);
+    }
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Print
 // 	Print the scheduler state -- in other words, the contents of
@@ -239,5 +1654,91 @@ Scheduler::Print()
 {
     //cout << "Ready list contents : ";
     readyList->Apply(ThreadPrint);
+    for (int i = 0; i < numCPUs; i++) {
+	for (int level = 0; level < NumPriorities; level++) {
+	    RunQueue *queue = cpus[i]->runQueues[level];
+
+	    for (unsigned int j = 0; j < queue->Size(); j++) {
+		ThreadPrint(queue->Item(j));
+	    }
+	}
+    }
+    for (int i = 0; i < NumPriorities; i++) {
+	readyQueues[i]->Apply(ThreadPrint);
+    }
+    sjfList->Apply(ThreadPrint);
+    strideList->Apply(ThreadPrint);
+    edfList->Apply(ThreadPrint);
+    throttledList->Apply(ThreadPrint);
+    for (ListIterator<CPUQuota *> iter(quotas); !iter.IsDone(); iter.Next()) {
+	iter.Item()->throttled->Apply(ThreadPrint);
+    }
     //cout << "\n";
 }
+
+//----------------------------------------------------------------------
+// Scheduler::SelfTest, RTHog
+// 	Test that real-time budgets are enforced.  A real-time thread
+//	that always wants the CPU ("hog") runs ahead of us, a normal
+//	thread, but only for its budget: then it must be throttled --
+//	letting us run -- until its next period starts, when it must
+//	run again.
+//----------------------------------------------------------------------
+
+static bool hogDone;		// tells the hog to stop
+static int hogLastRan;		// when the hog last ran
+static Semaphore *hogFinished;
+
+static void
+LetTimePass()
+{
+    (void) kernel->interrupt->SetLevel(IntOff);
+    (void) kernel->interrupt->SetLevel(IntOn);	// advances the clock
+}
+
+static void
+RTHog(void *unused)
+{
+    while (!hogDone) {
+	hogLastRan = kernel->stats->totalTicks;
+	LetTimePass();
+    }
+    hogFinished->V();
+}
+
+void
+Scheduler::SelfTest()
+{
+    Thread *hog = new Thread("rt hog", 1);
+    IntStatus oldLevel;
+    bool admitted;
+    int throttledAt, deadline;
+
+    hogDone = FALSE;
+    hogLastRan = -1;
+    hogFinished = new Semaphore("rt hog finished", 0);
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
+    admitted = SetRealTime(hog, 10 * TimerTicks, 2 * TimerTicks);
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    ASSERT(admitted);
+
+    hog->Fork((VoidFunctionPtr) RTHog, NULL);
+    kernel->currentThread->Yield();	// the hog runs first, until it
+					// has used up its budget
+    throttledAt = kernel->stats->totalTicks;
+    deadline = hog->rtDeadline;
+    ASSERT(hogLastRan >= 0 && throttledAt < deadline);
+    ASSERT(hog->rtUsed >= hog->rtBudget);
+
+    while (kernel->stats->totalTicks < deadline) {
+	ASSERT(hogLastRan < throttledAt);	// throttled: it mustn't run
+	LetTimePass();
+    }
+    while (hogLastRan < deadline) {	// but it must in its next period
+	LetTimePass();
+    }
+
+    hogDone = TRUE;
+    hogFinished->P();
+    delete hogFinished;
+}
@@ -12,6 +12,167 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
+#include "stats.h"
+#include "runqueue.h"
+
+// Scheduling policies, selected with "-sched" on the command line.
+//	FIFO -- one ready list, round robin on every timer interrupt;
+//		if the ready threads' priorities differ (see
+//		Thread::getEffectivePriority), the most important
+//		runs first
+//	MLFQ -- multi-level feedback queue: threads that use up their
+//		quantum move down a level, threads that wake up from
+//		I/O (or other blocking) move up a level
+//	SJF  -- (approximate) shortest job first: the thread whose next
+//		CPU burst is predicted to be shortest runs first, and
+//		is not time-sliced
+//	PSJF -- SJF, but a thread that becomes ready preempts the
+//		running thread if it is predicted to finish sooner
+//	STRIDE -- proportional share: each thread gets CPU time in
+//		proportion to its tickets, deterministically (the
+//		thread that has received the least service, scaled
+//		by its tickets, runs next)
+//	LOTTERY -- proportional share, by holding a lottery among
+//		the ready threads' tickets at every timer interrupt
+
+enum SchedulerType { FIFO, MLFQ, SJF, PSJF, STRIDE, LOTTERY };
+
+// Whatever the policy, threads can also be put in a real-time class
+// (see Scheduler::SetRealTime): such a thread is entitled to a CPU
+// budget in every period, and ready real-time threads always run
+// before normal ones, earliest deadline (end of period) first.  A
+// real-time thread that uses up its budget is throttled -- it isn't
+// run again until its next period starts.  The timer enforces
+// budgets and deadlines, so both are only as exact as the interval
+// between timer interrupts.
+
+// A user program can also be given a CPU quota (see "-q"), like a
+// cgroup's CPU limit: together, its threads may run for at most a
+// budget of ticks in every period.  A thread of a program that has
+// used up its quota is throttled -- taken off the ready list until the
+// program's next period starts, even if that leaves the CPU idle.
+// Quotas apply to normal threads only; real-time threads have their
+// own budget.
+
+// Nachos can model a machine with several CPUs (see "-cpus").  The
+// CPUs take turns running on the one host thread: each time a thread
+// is dispatched, it is the next CPU's turn, so no two threads ever run
+// at the same time, and more CPUs don't get more work done.  (They
+// are not run on host threads of their own: the interrupt and timer
+// simulation, the statistics and main memory are all shared and
+// unsynchronized.)
+//
+// Under FIFO, each CPU has run queues of its own (see runqueue.h), one
+// for each effective priority: a thread that becomes ready goes on a
+// queue of the CPU that made it ready -- usually the one it was
+// running on, where its registers may still be (see
+// Thread::RestoreUserState).  Each CPU keeps a mask of its non-empty
+// queues, so the most important waiting thread is found without
+// looking through the queues.  A CPU with nothing waiting steals the
+// last thread from the CPU with the most threads waiting at that
+// priority, as long as that CPU has more than the one it will run on
+// its own next turn.  The other policies share their ready queues
+// between all the CPUs.
+
+// Number of MLFQ priority levels; level 0 is the highest.  Must be
+// no more than the number of bits in an unsigned int.
+const int NumPriorities = 8;
+
+// How often (in timer interrupts) every MLFQ thread is moved back to
+// the top level, so that CPU-bound threads can't starve.
+const int MLFQBoostSlices = 64;
+
+// SJF burst prediction: the next burst is predicted to be
+//	SJFAlpha * (last burst) + (1 - SJFAlpha) * (last prediction)
+// and a new thread is predicted to need SJFInitialBurst ticks.
+const double SJFAlpha = 0.5;
+const int SJFInitialBurst = 100;
+
+// Proportional share: a thread starts out with DefaultTickets (a
+// user program can ask for more or fewer, see SC_SetTickets).  Under
+// STRIDE, running for one timer interval advances a thread's pass
+// by StrideScale / (its tickets).
+const int DefaultTickets = 100;
+const int StrideScale = 10000;
+
+// Adaptive time slices (FIFO, STRIDE, LOTTERY): a thread's quantum
+// starts at TimerTicks, doubles each time it runs for its whole
+// quantum, and halves each time it blocks having used less than
+// half of it, within these bounds.
+const int MinQuantum = TimerTicks / 4;
+const int MaxQuantum = TimerTicks * 8;
+
+// Scheduling parameters for a new thread (see Kernel::ExecV).
+
+class SchedParams {
+  public:
+    SchedParams(int numTickets) 
+	{ tickets = numTickets; priority = 0; rtPeriod = rtBudget = 0;
+	  quotaPeriod = quotaBudget = 0; }
+
+    int tickets;		// share of the CPU (STRIDE, LOTTERY)
+    int priority;		// 0 (the highest) to NumPriorities - 1
+				// (FIFO; MLFQ starts it at that level)
+    int rtPeriod;		// real-time period, or 0 for the
+				// normal class
+    int rtBudget;		// CPU ticks it needs every period
+    int quotaPeriod;		// CPU quota period, or 0 for no quota
+    int quotaBudget;		// CPU ticks it may use every period
+};
+
+// The following class defines one simulated CPU, as far as the
+// scheduler is concerned.
+
+class CPU {
+  public:
+    CPU(int cpuID);		// initialize an idle CPU
+    ~CPU();			// de-allocate it
+
+    int id;			// which CPU this is
+    RunQueue *runQueues[NumPriorities];
+				// threads waiting to run on this CPU,
+				// at each effective priority (FIFO)
+    unsigned int readyMask;	// bit i set iff runQueues[i] is not
+				// empty
+    int busyTicks;		// ticks spent running threads
+    int numDispatches;		// # of threads dispatched here
+    int numSteals;		// # of threads taken from another
+				// CPU's run queue
+    int numMigrations;		// # of threads that came here from
+				// another CPU
+
+    void Push(Thread* thread, int level, bool atFront);
+				// put "thread" on the queue for "level"
+    Thread *Take(int level);	// take the first thread at "level" off
+				// its queue
+    Thread *TakeLast(int level);// ... the last one, to steal it
+    void Remove(Thread* thread, int level);
+				// take "thread" off the queue for "level"
+};
+
+// The following class defines the CPU quota of a user program: the
+// threads running it may use at most "budget" ticks, together, in
+// every period of "period" ticks.
+
+class CPUQuota {
+  public:
+    CPUQuota(char *programName, int quotaPeriod, int quotaBudget);
+				// start the first period
+    ~CPUQuota();		// de-allocate the quota
+
+    char *name;			// the program's name (our own copy)
+    int period;			// length of a period, in ticks
+    int budget;			// CPU ticks allowed every period
+    int periodEnd;		// when the current period ends
+    int used;			// CPU ticks used this period (by
+				// bursts that have ended)
+    ThreadQueue *throttled;	// threads waiting for the next period
+    int numThrottled;		// # of periods in which the program
+				// was throttled
+    int throttledTicks;		// total time it spent throttled
+    int throttledSince;		// when it was throttled this period;
+				// -1 if it hasn't been
+};
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
@@ -19,7 +180,8 @@
 
 class Scheduler {
   public:
-    Scheduler();		// Initialize list of ready threads 
+    Scheduler(SchedulerType type, int numCPUs);
+				// Initialize list of ready threads 
     ~Scheduler();		// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	
@@ -31,12 +193,136 @@ class Scheduler {
     void CheckToBeDestroyed();// Check if thread that had been
     				// running needs to be deleted
     void Print();		// Print contents of ready list
+
+    bool SliceExpired(Thread* thread);
+				// Called on each timer interrupt; 
+				// should "thread" be preempted?
+    void ArmTimer(Thread* thread);
+				// set the timer to go off when we next
+				// need to look at "thread", if ever
+    SchedulerType getType() { return type; }
+    bool SetRealTime(Thread* thread, int period, int budget);
+				// move "thread" to (or, if "period"
+				// is 0, out of) the real-time class;
+				// FALSE if it can't be admitted
+    bool CanAdmit(int period, int budget);
+				// is there room for a real-time thread
+				// with this period and budget?
+    void Reprioritize(Thread* thread, int donated);
+				// "thread" has been donated a new
+				// priority (see Lock::Acquire)
+    bool HonorsPriority() { return (type == FIFO || type == MLFQ); }
+				// are threads run in priority order?
+    void CheckDeadlines();	// called on each timer interrupt; start
+				// a new period for real-time threads
+				// whose deadline has passed
+    CPUQuota *NewQuota(char *name, int period, int budget);
+				// a CPU quota for program "name"
+    bool OverQuota(Thread* thread);
+				// has "thread"'s program used up its
+				// CPU quota for this period?
+    void CheckQuotas();		// called on each timer interrupt; start
+				// a new period for throttled programs
+				// whose period has ended
+    void RecordThreads();	// report statistics of every thread
+				// that hasn't finished yet, and of
+				// every CPU (at Halt)
+    void Retire(Thread* thread);// "thread" has finished; report its
+				// statistics, release its reservation
     
-    // SelfTest for scheduler is implemented in class Thread
+    void SelfTest();		// test real-time budget enforcement;
+				// the rest is tested by Thread::SelfTest
     
   private:
-    List<Thread *> *readyList;  // queue of threads that are ready to run,
-				// but not running
+    SchedulerType type;		// which policy we use
+    CPU *cpus[MaxCPUs];		// the CPUs, with their run queues
+    int numCPUs;		// # of entries in "cpus"
+    int currentCPU;		// the CPU the running thread is on
+    int numQueued;		// # of threads on all the run queues
+    ThreadQueue *readyList;	// queue of threads that are ready to run,
+				// but not running (LOTTERY)
+    ThreadQueue *readyQueues[NumPriorities];
+				// ready threads at each level (MLFQ)
+    unsigned int readyMask;	// bit i set iff readyQueues[i] is
+				// not empty
+    SortedThreadQueue *sjfList;
+				// ready threads, shortest predicted
+				// burst first (SJF, PSJF)
+    SortedThreadQueue *strideList;
+				// ready threads, lowest pass first
+				// (STRIDE)
+    double globalPass;		// pass of the thread dispatched most
+				// recently (STRIDE)
+    SortedThreadQueue *edfList;
+				// ready real-time threads, earliest
+				// deadline first
+    SortedThreadQueue *throttledList;
+				// real-time threads that have used up
+				// their budget, by start of next period
+    double rtUtilization;	// fraction of the CPU reserved by
+				// real-time threads
+    List<CPUQuota *> *quotas;	// every CPU quota ever given out
+    int numQuotaThrottled;	// # of threads throttled by a quota
+    int slicesSinceBoost;	// timer interrupts since every thread
+				// was last moved to the top level
+
+    int Quantum(int level) { return 1 << level; }
+				// timer interrupts a thread may run
+				// at "level" before it is demoted
+    void Boost();		// move every thread to the top level
+    void EndBurst(Thread* thread);
+				// "thread" is giving up the CPU; update
+				// its burst prediction
+    bool ShouldPreempt(Thread* thread);
+				// does "thread" beat the running one? (PSJF)
+    int TimeSlice(Thread* thread);
+				// how long "thread" may run before the
+				// next timer interrupt
+    bool NeedsTimer(Thread* thread);
+				// could a timer interrupt change what
+				// runs, or is "thread" on its own?
+    bool Adaptive() { return (type == FIFO || type == STRIDE
+					|| type == LOTTERY); }
+				// do quanta adapt to each thread?
+    bool PerCPU(Thread* thread)
+	{ return (type == FIFO && !thread->isRealTime()); }
+				// does "thread" go on a CPU's own
+				// run queue, rather than a shared one?
+    void Enqueue(Thread* thread, bool atFront);
+				// put "thread" on the current CPU's
+				// run queue
+    Thread *Dequeue();		// take a thread off the run queue of
+				// the next CPU that has one
+    int BestQueuedLevel();	// best priority on any run queue
+    Thread *Steal(CPU* thief, int level);
+				// take a thread at "level" off the
+				// longest run queue for "thief", if it
+				// is worth it
+    void Migrate(Thread* thread, CPU* cpu);
+				// "thread" is moving to "cpu"
+    void WakeInteractive(Thread* thread);
+				// "thread" is interactive, and just woke
+				// up; get it the CPU soon
+    double CurrentPass(Thread* thread);
+				// "thread"'s pass, counting the burst
+				// it is running now (STRIDE)
+    Thread *DrawLottery(Thread* running);
+				// pick a ready thread (or "running")
+				// with odds proportional to tickets
+    void RecordThread(Thread* thread);
+				// report statistics of "thread"
+    int RTUsed(Thread* thread);	// CPU ticks "thread" has used this
+				// period, counting the current burst
+    void NewPeriod(Thread* thread);
+				// start "thread"'s next period
+    bool RTPreempts(Thread* thread);
+				// does real-time "thread" beat the
+				// running one?
+    int QuotaUsed(Thread* thread);
+				// CPU ticks "thread"'s program has used
+				// this period, counting the current burst
+    void NewQuotaPeriod(CPUQuota* quota);
+				// start the next period of "quota"
     Thread *toBeDestroyed;	// finishing thread to be destroyed
     				// by the next thread that runs
 };
@@ -18,15 +18,21 @@
 //
 // Once we'e implemented one set of higher level atomic operations,
 // we can implement others using that implementation.  We illustrate
-// this by implementing locks and condition variables on top of 
-// semaphores, instead of directly enabling and disabling interrupts.
+// this by implementing SynchLists (see synchlist.h) on top of locks
+// and condition variables.
 //
-// Locks are implemented using a semaphore to keep track of
-// whether the lock is held or not -- a semaphore value of 0 means
-// the lock is busy; a semaphore value of 1 means the lock is free.
+// Locks are implemented directly, like semaphores, rather than on
+// top of one: a lock has to know which threads are waiting for it,
+// and how important they are, to donate their priority to the thread
+// holding it, and to hand the lock to the right one on Release.
 //
-// The implementation of condition variables using semaphores is
-// a bit trickier, as explained below under Condition::Wait.
+// Condition variables, like semaphores, keep a queue of the waiting
+// threads themselves, so waiting and signalling never allocate memory.
+//
+// With synchronization profiling on, a semaphore or lock counts the
+// times it is acquired, and how long threads waited for it; a lock also
+// counts how long it was held; a condition variable counts how long
+// threads waited to be signalled.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -48,7 +54,11 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List<Thread *>;
+    queue = new ThreadQueue;
+    record = NULL;
+    if (kernel->profileSynch) {
+	record = kernel->stats->SynchRecordFor("semaphore", name);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -81,12 +91,18 @@ Semaphore::P()
     
     // disable interrupts
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	
+    int waitStart = kernel->stats->totalTicks;
+    bool waited = FALSE;
     
     while (value == 0) { 		// semaphore not available
 	queue->Append(currentThread);	// so go to sleep
 	currentThread->Sleep(FALSE);
+	waited = TRUE;
     } 
     value--; 			// semaphore available, consume its value
+    if (record != NULL) {
+	record->Acquired(waited, kernel->stats->totalTicks - waitStart);
+    }
    
     // re-enable interrupts
     (void) interrupt->SetLevel(oldLevel);	
@@ -160,48 +176,295 @@ Semaphore::SelfTest()
 Lock::Lock(char* debugName)
 {
     name = debugName;
-    semaphore = new Semaphore("lock", 1);  // initially, unlocked
     lockHolder = NULL;
+    queue = new ThreadQueue;
+    nextHeld = NULL;
+    record = NULL;
+    if (kernel->profileSynch) {
+	record = kernel->stats->SynchRecordFor("lock", name);
+    }
+    acquiredAt = 0;
 }
 
 //----------------------------------------------------------------------
 // Lock::~Lock
-// 	Deallocate a lock
+// 	Deallocate a lock.  Assume no one holds it, or is waiting for it!
 //----------------------------------------------------------------------
 Lock::~Lock()
 {
-    delete semaphore;
+    ASSERT(lockHolder == NULL);
+    delete queue;
 }
 
 //----------------------------------------------------------------------
 // Lock::Acquire
 //	Atomically wait until the lock is free, then set it to busy.
-//	Equivalent to Semaphore::P(), with the semaphore value of 0
-//	equal to busy, and semaphore value of 1 equal to free.
+//	While we wait, the thread holding the lock runs with (at least)
+//	our priority.  Release hands the lock straight to us, so when
+//	we wake up, we already hold it.
 //----------------------------------------------------------------------
 
 void Lock::Acquire()
 {
-    semaphore->P();
-    lockHolder = kernel->currentThread;
+    Interrupt *interrupt = kernel->interrupt;
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int waitStart = kernel->stats->totalTicks;
+
+    ASSERT(!IsHeldByCurrentThread());
+    if (lockHolder == NULL) {
+	lockHolder = currentThread;
+	nextHeld = currentThread->heldLocks;
+	currentThread->heldLocks = this;
+	acquiredAt = waitStart;
+	if (record != NULL) {
+	    record->Acquired(FALSE, 0);
+	}
+    } else {
+	currentThread->waitingFor = this;
+	queue->Append(currentThread);
+	Donate(currentThread);
+	currentThread->Sleep(FALSE);
+	ASSERT(lockHolder == currentThread);
+	currentThread->waitingFor = NULL;
+	if (record != NULL) {
+	    record->Acquired(TRUE, kernel->stats->totalTicks - waitStart);
+	}
+    }
+    (void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Lock::Release
-//	Atomically set lock to be free, waking up a thread waiting
-//	for the lock, if any.
-//	Equivalent to Semaphore::V(), with the semaphore value of 0
-//	equal to busy, and semaphore value of 1 equal to free.
+//	Atomically set lock to be free -- or, if threads are waiting for
+//	it, give it to the most important one, and wake that up.  We
+//	give back the priority the waiters donated to us, keeping only
+//	what the waiters for other locks we hold have donated.
 //
 //	By convention, only the thread that acquired the lock
 // 	may release it.
+//
+//	The lock counts as held by the waiter from the moment it is
+//	handed over, even though the waiter has yet to run.
 //---------------------------------------------------------------------
 
 void Lock::Release()
 {
+    Interrupt *interrupt = kernel->interrupt;
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Thread *next;
+
     ASSERT(IsHeldByCurrentThread());
+    Unlink();
     lockHolder = NULL;
-    semaphore->V();
+    if (record != NULL) {
+	record->Released(kernel->stats->totalTicks - acquiredAt);
+    }
+    acquiredAt = kernel->stats->totalTicks;
+    if (!queue->IsEmpty()) {
+	next = BestWaiter();
+	queue->Remove(next);
+	lockHolder = next;
+	nextHeld = next->heldLocks;
+	next->heldLocks = this;
+	kernel->scheduler->Reprioritize(next, DonatedTo(next));
+	kernel->scheduler->ReadyToRun(next);
+    }
+    kernel->scheduler->Reprioritize(currentThread, DonatedTo(currentThread));
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::Donate
+//	A thread is about to wait for the lock; make sure the holder
+//	runs with at least its priority.  If the holder is itself
+//	waiting for a lock, the holder of that lock must run first, so
+//	it gets the priority too, and so on down the chain.  The chain
+//	ends with a thread that isn't waiting, or that already has the
+//	priority (which is also how a deadlock cycle ends).
+//
+//	If the scheduler ignores priorities, there is no point.
+//
+//	"donor" is the thread that is about to wait
+//----------------------------------------------------------------------
+
+void Lock::Donate(Thread *donor)
+{
+    int level = donor->getEffectivePriority();
+    Thread *holder = lockHolder;
+
+    if (!kernel->scheduler->HonorsPriority()) {
+	return;
+    }
+    while (holder != NULL && level < holder->getEffectivePriority()) {
+	DEBUG(dbgThread, donor->getName() << " donates level " << level
+			<< " to " << holder->getName());
+	kernel->scheduler->Reprioritize(holder, level);
+	if (holder->waitingFor == NULL) {
+	    break;
+	}
+	holder = holder->waitingFor->lockHolder;
+    }
+}
+
+//----------------------------------------------------------------------
+// Lock::WaiterPriority
+//	Return the best (lowest) effective priority among the threads
+//	waiting for the lock, or NumPriorities if there are none.
+//----------------------------------------------------------------------
+
+int Lock::WaiterPriority()
+{
+    int level = NumPriorities;
+
+    for (ThreadQueueIterator iter(queue); !iter.IsDone(); iter.Next()) {
+	level = min(level, iter.Item()->getEffectivePriority());
+    }
+    return level;
+}
+
+//----------------------------------------------------------------------
+// Lock::BestWaiter
+//	Return the thread that should get the lock next: the one with
+//	the best effective priority, or, among equals, the one that has
+//	waited longest.  There must be at least one.
+//----------------------------------------------------------------------
+
+Thread *Lock::BestWaiter()
+{
+    Thread *best = queue->Front();
+
+    for (ThreadQueueIterator iter(queue); !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->getEffectivePriority()
+			< best->getEffectivePriority()) {
+	    best = iter.Item();
+	}
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// Lock::DonatedTo
+//	Return the priority donated to a thread: the best priority among
+//	the threads waiting for any of the locks it holds, or
+//	NumPriorities if there are none.
+//
+//	"thread" is the thread whose locks we look at
+//----------------------------------------------------------------------
+
+int Lock::DonatedTo(Thread *thread)
+{
+    int level = NumPriorities;
+
+    for (Lock *lock = thread->heldLocks; lock != NULL; lock = lock->nextHeld) {
+	level = min(level, lock->WaiterPriority());
+    }
+    return level;
+}
+
+//----------------------------------------------------------------------
+// Lock::Unlink
+//	Take the lock off the list of locks its holder holds.
+//----------------------------------------------------------------------
+
+void Lock::Unlink()
+{
+    Lock **ptr = &lockHolder->heldLocks;
+
+    while (*ptr != this) {
+	ASSERT(*ptr != NULL);
+	ptr = &(*ptr)->nextHeld;
+    }
+    *ptr = nextHeld;
+    nextHeld = NULL;
+}
+
+//----------------------------------------------------------------------
+// Lock::SelfTest, InheritMiddle, InheritTop
+// 	Test priority inheritance, with a chain of three threads: the
+//	test thread, at the lowest priority, holds this lock; "middle"
+//	holds a second lock, and waits for this one; "top", at the
+//	highest priority, waits for the second lock.  Both donations
+//	must reach the test thread, and go away when it releases the
+//	lock -- at which point the other two, being more important,
+//	must both run to completion before it runs again.
+//
+//	If the scheduler ignores priorities, nothing may be donated.
+//----------------------------------------------------------------------
+
+static Lock *testLock, *innerLock;
+static int numInheritDone;	// # of the threads above that are done
+
+static void
+InheritMiddle(void *unused)
+{
+    innerLock->Acquire();
+    testLock->Acquire();	// waits for the test thread
+    testLock->Release();
+    innerLock->Release();
+    numInheritDone++;
+}
+
+static void
+InheritTop(void *unused)
+{
+    innerLock->Acquire();	// waits for "middle"
+    innerLock->Release();
+    numInheritDone++;
+}
+
+void
+Lock::SelfTest()
+{
+    Thread *self = kernel->currentThread;
+    int ownPriority = self->getPriority();
+    bool honored = kernel->scheduler->HonorsPriority();
+    Thread *middle = new Thread("middle", 1);
+    Thread *top = new Thread("top", 1);
+
+    ASSERT(lockHolder == NULL);		// otherwise test won't work!
+    testLock = this;
+    innerLock = new Lock("inner");
+    numInheritDone = 0;
+    Acquire();
+    self->setPriority(NumPriorities - 1);
+    middle->setPriority(NumPriorities / 2);
+    top->setPriority(0);
+
+    middle->Fork((VoidFunctionPtr) InheritMiddle, NULL);
+    while (middle->waitingFor != this) {
+	self->Yield();
+    }
+    if (honored) {
+	ASSERT(self->getEffectivePriority()
+			== middle->getEffectivePriority());
+    } else {
+	ASSERT(self->getEffectivePriority() == NumPriorities - 1);
+    }
+
+    top->Fork((VoidFunctionPtr) InheritTop, NULL);
+    while (top->waitingFor != innerLock) {
+	self->Yield();
+    }
+    if (honored) {
+	ASSERT(middle->getEffectivePriority() == top->getEffectivePriority());
+	ASSERT(self->getEffectivePriority() == top->getEffectivePriority());
+    } else {
+	ASSERT(self->getEffectivePriority() == NumPriorities - 1);
+    }
+
+    Release();			// if priorities count, we yield to
+				// "middle", then it to "top"
+    ASSERT(self->getEffectivePriority() == NumPriorities - 1);
+    if (honored) {
+	ASSERT(numInheritDone == 2);
+    }
+    while (numInheritDone < 2) {	// let them finish
+	self->Yield();
+    }
+    self->setPriority(ownPriority);
+    delete innerLock;
 }
 
 //----------------------------------------------------------------------
@@ -215,27 +478,33 @@ void Lock::Release()
 Condition::Condition(char* debugName)
 {
     name = debugName;
-    waitQueue = new List<Semaphore *>;
+    waitQueue = new ThreadQueue;
+    record = NULL;
+    if (kernel->profileSynch) {
+	record = kernel->stats->SynchRecordFor("condition", name);
+    }
 }
 
 //----------------------------------------------------------------------
 // Condition::Condition
 // 	Deallocate the data structures implementing a condition variable.
+//	Assume no one is still waiting on the condition!
 //----------------------------------------------------------------------
 
 Condition::~Condition()
 {
+    ASSERT(waitQueue->IsEmpty());
     delete waitQueue;
 }
 
 //----------------------------------------------------------------------
 // Condition::Wait
 // 	Atomically release monitor lock and go to sleep.
-//	Our implementation uses semaphores to implement this, by
-//	allocating a semaphore for each waiting thread.  The signaller
-//	will V() this semaphore, so there is no chance the waiter
-//	will miss the signal, even though the lock is released before
-//	calling P().
+//	We put ourselves on the wait queue before releasing the lock,
+//	and keep interrupts disabled until we are asleep, so there is
+//	no chance we miss a signal: the signaller has to hold the lock
+//	to find us on the queue, and can only take us off it once we
+//	are ready to be woken.
 //
 //	Note: we assume Mesa-style semantics, which means that the
 //	waiter must re-acquire the monitor lock when waking up.
@@ -245,16 +514,23 @@ Condition::~Condition()
 
 void Condition::Wait(Lock* conditionLock) 
 {
-     Semaphore *waiter;
+    Interrupt *interrupt = kernel->interrupt;
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel;
+    int waitStart;
     
-     ASSERT(conditionLock->IsHeldByCurrentThread());
+    ASSERT(conditionLock->IsHeldByCurrentThread());
 
-     waiter = new Semaphore("condition", 0);
-     waitQueue->Append(waiter);
-     conditionLock->Release();
-     waiter->P();
-     conditionLock->Acquire();
-     delete waiter;
+    oldLevel = interrupt->SetLevel(IntOff);
+    waitStart = kernel->stats->totalTicks;
+    waitQueue->Append(currentThread);
+    conditionLock->Release();
+    currentThread->Sleep(FALSE);
+    if (record != NULL) {
+	record->Acquired(TRUE, kernel->stats->totalTicks - waitStart);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    conditionLock->Acquire();
 }
 
 //----------------------------------------------------------------------
@@ -266,21 +542,23 @@ void Condition::Wait(Lock* conditionLock)
 //	being woken up (unlike Hoare-style).
 //
 //	Also note: we assume the caller holds the monitor lock
-//	(unlike what is described in Birrell's paper).  This allows
-//	us to access waitQueue without disabling interrupts.
+//	(unlike what is described in Birrell's paper).  Interrupts
+//	still have to be disabled, since Scheduler::ReadyToRun
+//	assumes they are.
 //
 //	"conditionLock" -- lock protecting the use of this condition
 //----------------------------------------------------------------------
 
 void Condition::Signal(Lock* conditionLock)
 {
-    Semaphore *waiter;
+    IntStatus oldLevel;
     
     ASSERT(conditionLock->IsHeldByCurrentThread());
     
     if (!waitQueue->IsEmpty()) {
-        waiter = waitQueue->RemoveFront();
-	waiter->V();
+	oldLevel = kernel->interrupt->SetLevel(IntOff);
+	kernel->scheduler->ReadyToRun(waitQueue->RemoveFront());
+	(void) kernel->interrupt->SetLevel(oldLevel);
     }
 }
 
@@ -293,7 +571,609 @@ void Condition::Signal(Lock* conditionLock)
 
 void Condition::Broadcast(Lock* conditionLock) 
 {
+    IntStatus oldLevel;
+
+    ASSERT(conditionLock->IsHeldByCurrentThread());
+
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
     while (!waitQueue->IsEmpty()) {
-        Signal(conditionLock);
+	kernel->scheduler->ReadyToRun(waitQueue->RemoveFront());
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a reader-writer lock, so that it can be used for
+//	synchronization.  Initially, no one is reading or writing.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char* debugName)
+{
+    name = debugName;
+    lock = new Lock("rwlock");
+    turn = new Condition("rwlock turn");
+    nextTicket = nowServing = 0;
+    numReaders = 0;
+    writing = FALSE;
+    numReads = numWrites = numReadWaits = numWriteWaits = 0;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+// 	Deallocate a reader-writer lock.  Assume no one holds it!
+//----------------------------------------------------------------------
+
+RWLock::~RWLock()
+{
+    ASSERT(numReaders == 0 && !writing);
+    delete turn;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead
+// 	Take a ticket, and wait until it is our turn and no one is
+//	writing.  Then let the next thread in line have its turn: if
+//	that is a reader too, it can read alongside us.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireRead()
+{
+    int ticket;
+
+    lock->Acquire();
+    ticket = nextTicket++;
+    numReads++;
+    if (ticket != nowServing || writing) {
+	numReadWaits++;
+	do {
+	    turn->Wait(lock);
+	} while (ticket != nowServing || writing);
+    }
+    numReaders++;
+    nowServing++;
+    turn->Broadcast(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseRead
+// 	Done reading.  If we were the last reader, a writer may be
+//	waiting for its turn.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseRead()
+{
+    lock->Acquire();
+    ASSERT(numReaders > 0);
+    if (--numReaders == 0) {
+	turn->Broadcast(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite
+// 	Take a ticket, and wait until it is our turn and no one else
+//	is reading or writing.  The next thread in line waits until
+//	we are done.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireWrite()
+{
+    int ticket;
+
+    lock->Acquire();
+    ticket = nextTicket++;
+    numWrites++;
+    if (ticket != nowServing || writing || numReaders > 0) {
+	numWriteWaits++;
+	do {
+	    turn->Wait(lock);
+	} while (ticket != nowServing || writing || numReaders > 0);
+    }
+    writing = TRUE;
+    nowServing++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseWrite
+// 	Done writing; let the next thread in line have its turn.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseWrite()
+{
+    lock->Acquire();
+    ASSERT(writing);
+    writing = FALSE;
+    turn->Broadcast(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::Print
+// 	Print how often the lock was acquired, and how often a thread
+//	had to wait for it.
+//----------------------------------------------------------------------
+
+void
+RWLock::Print()
+{
+    cout << name << ": " << numReads << " reads (" << numReadWaits
+	<< " waited), " << numWrites << " writes (" << numWriteWaits
+	<< " waited)\n";
+}
+
+//----------------------------------------------------------------------
+// RWLock::SelfTest, RWSelfTestReader, RWSelfTestWriter
+// 	Test the reader-writer lock implementation.  While the test
+//	thread reads, a writer has to wait; a reader that comes after
+//	the writer has to wait too, and must get the lock after the
+//	writer.
+//----------------------------------------------------------------------
+
+static RWLock *testRWLock;
+static char rwOrder[2];
+static int rwNumDone;
+
+static void
+RWSelfTestWriter(void *unused)
+{
+    testRWLock->AcquireWrite();
+    rwOrder[0] = (rwOrder[1] == 0) ? 'W' : 'X';	// first?
+    testRWLock->ReleaseWrite();
+    rwNumDone++;
+}
+
+static void
+RWSelfTestReader(void *unused)
+{
+    testRWLock->AcquireRead();
+    rwOrder[1] = (rwOrder[0] == 'W') ? 'R' : 'X';	// second?
+    testRWLock->ReleaseRead();
+    rwNumDone++;
+}
+
+void
+RWLock::SelfTest()
+{
+    Thread *self = kernel->currentThread;
+    Thread *writer = new Thread("writer", 1);
+    Thread *reader = new Thread("reader", 1);
+
+    ASSERT(nextTicket == nowServing);	// otherwise test won't work!
+    testRWLock = this;
+    rwOrder[0] = rwOrder[1] = 0;
+    rwNumDone = 0;
+
+    AcquireRead();
+    AcquireRead();			// readers share the lock
+    ReleaseRead();
+
+    writer->Fork((VoidFunctionPtr) RWSelfTestWriter, NULL);
+    while (numWriteWaits == 0) {
+	self->Yield();
+    }
+    reader->Fork((VoidFunctionPtr) RWSelfTestReader, NULL);
+    while (numReadWaits == 0) {
+	self->Yield();
+    }
+    ASSERT(rwOrder[0] == 0 && rwOrder[1] == 0);
+    ReleaseRead();
+    while (rwNumDone < 2) {
+	self->Yield();
+    }
+    ASSERT(rwOrder[0] == 'W' && rwOrder[1] == 'R');
+    ASSERT(numReads == 3 && numWrites == 1);
+}
+
+//----------------------------------------------------------------------
+// SeqLock::SeqLock
+// 	Initialize a sequence lock.  Initially, no one is writing.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+SeqLock::SeqLock(char* debugName)
+{
+    name = debugName;
+    writeLock = new Lock("seqlock writer");
+    sequence = 0;
+    numReads = numRetries = numWrites = 0;
+}
+
+//----------------------------------------------------------------------
+// SeqLock::~SeqLock
+// 	Deallocate a sequence lock.  Assume no one is writing!
+//----------------------------------------------------------------------
+
+SeqLock::~SeqLock()
+{
+    ASSERT((sequence & 1) == 0);
+    delete writeLock;
+}
+
+//----------------------------------------------------------------------
+// SeqLock::ReadBegin
+// 	Start reading the data.  If a writer is in the middle of
+//	changing it, there is no point in reading it yet: let the
+//	writer run until it is done.  Return the (even) sequence number
+//	at which we start.
+//----------------------------------------------------------------------
+
+unsigned int
+SeqLock::ReadBegin()
+{
+    unsigned int seq;
+
+    numReads++;
+    while ((seq = sequence) & 1) {
+	kernel->currentThread->Yield();
+    }
+    __sync_synchronize();		// read the data after "sequence"
+    return seq;
+}
+
+//----------------------------------------------------------------------
+// SeqLock::ReadRetry
+// 	Return TRUE if a writer started since ReadBegin returned "seq",
+//	in which case what was read may be inconsistent, and has to be
+//	read again.
+//
+//	"seq" is the value ReadBegin returned
+//----------------------------------------------------------------------
+
+bool
+SeqLock::ReadRetry(unsigned int seq)
+{
+    __sync_synchronize();		// read "sequence" after the data
+    if (sequence != seq) {
+	numRetries++;
+	return TRUE;
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// SeqLock::WriteBegin
+// 	Wait for any other writer to finish, then make the sequence
+//	number odd, so readers know the data is changing.
+//----------------------------------------------------------------------
+
+void
+SeqLock::WriteBegin()
+{
+    writeLock->Acquire();
+    numWrites++;
+    sequence = sequence + 1;
+    __sync_synchronize();		// write the data after "sequence"
+}
+
+//----------------------------------------------------------------------
+// SeqLock::WriteEnd
+// 	Done writing; make the sequence number even again, and let in
+//	the next writer.
+//----------------------------------------------------------------------
+
+void
+SeqLock::WriteEnd()
+{
+    ASSERT(sequence & 1);
+    __sync_synchronize();		// write "sequence" after the data
+    sequence = sequence + 1;
+    writeLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SeqLock::Print
+// 	Print how many reads and writes there were, and how many reads
+//	had to be retried because of a writer.
+//----------------------------------------------------------------------
+
+void
+SeqLock::Print()
+{
+    cout << name << ": " << numReads << " reads (" << numRetries
+	<< " retried), " << numWrites << " writes\n";
+}
+
+//----------------------------------------------------------------------
+// SeqLock::SelfTest, SeqSelfTestWriter
+// 	Test the sequence lock implementation.  A read during which a
+//	writer changes the data must be retried; one during which no
+//	writer runs must not be.  Data a writer leaves half-written is
+//	never read.
+//----------------------------------------------------------------------
+
+static SeqLock *testSeqLock;
+static int seqFirst, seqSecond;		// the writer keeps these equal
+static bool seqWriterDone;
+
+static void
+SeqSelfTestWriter(void *unused)
+{
+    testSeqLock->WriteBegin();
+    seqFirst++;
+    kernel->currentThread->Yield();	// let the reader see us writing
+    seqSecond++;
+    testSeqLock->WriteEnd();
+    seqWriterDone = TRUE;
+}
+
+void
+SeqLock::SelfTest()
+{
+    Thread *self = kernel->currentThread;
+    Thread *writer = new Thread("writer", 1);
+    unsigned int seq, before;
+    int first, second;
+
+    testSeqLock = this;
+    seqFirst = seqSecond = 0;
+    seqWriterDone = FALSE;
+
+    seq = ReadBegin();
+    ASSERT(!ReadRetry(seq));
+
+    before = ReadBegin();
+    writer->Fork((VoidFunctionPtr) SeqSelfTestWriter, NULL);
+    while (seqFirst == 0) {
+	self->Yield();
+    }
+    ASSERT(ReadRetry(before));		// the writer got in the way
+    do {				// waits for the writer to finish
+	seq = ReadBegin();
+	first = seqFirst;
+	second = seqSecond;
+    } while (ReadRetry(seq));
+    ASSERT(first == 1 && second == 1);
+    ASSERT(numRetries == 1);
+    while (!seqWriterDone) {
+	self->Yield();
+    }
+}
+
+//----------------------------------------------------------------------
+// Once::Once
+// 	Initialize a once object; its function hasn't run yet.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Once::Once(char* debugName)
+{
+    name = debugName;
+    lock = new Lock("once");
+    done = FALSE;
+    numCalls = numWaits = 0;
+}
+
+//----------------------------------------------------------------------
+// Once::~Once
+// 	Deallocate a once object.
+//----------------------------------------------------------------------
+
+Once::~Once()
+{
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// Once::Run
+// 	Call a function, unless it has been called already.  Once it
+//	has finished, this costs nothing but a test; while it is
+//	running, the lock makes other callers wait for it.
+//
+//	"func" is the function to call
+//	"arg" is the argument to pass to it
+//----------------------------------------------------------------------
+
+void
+Once::Run(VoidFunctionPtr func, void *arg)
+{
+    numCalls++;
+    if (done) {
+	__sync_synchronize();		// see what "func" did
+	return;
+    }
+    if (lock->IsHeld()) {
+	numWaits++;
+    }
+    lock->Acquire();
+    if (!done) {
+	(*func)(arg);
+	__sync_synchronize();		// "func" is done before "done"
+	done = TRUE;
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Once::Print
+// 	Print how often Run was called, and how often a caller had to
+//	wait for the function to finish.
+//----------------------------------------------------------------------
+
+void
+Once::Print()
+{
+    cout << name << ": " << numCalls << " calls (" << numWaits
+	<< " waited)\n";
+}
+
+//----------------------------------------------------------------------
+// Once::SelfTest, OnceSelfTestInit, OnceSelfTestHelper
+// 	Test the once implementation.  Two threads call Run at the same
+//	time; the function, which takes a while, must run just once,
+//	and both must see that it has finished.
+//----------------------------------------------------------------------
+
+static Once *testOnce;
+static int onceNumRuns;
+static bool onceHelperDone;
+
+static void
+OnceSelfTestInit(void *unused)
+{
+    for (int i = 0; i < 3; i++) {
+	kernel->currentThread->Yield();	// let the other caller in
+    }
+    onceNumRuns++;
+}
+
+static void
+OnceSelfTestHelper(void *unused)
+{
+    testOnce->Run((VoidFunctionPtr) OnceSelfTestInit, NULL);
+    ASSERT(onceNumRuns == 1);
+    onceHelperDone = TRUE;
+}
+
+void
+Once::SelfTest()
+{
+    Thread *self = kernel->currentThread;
+    Thread *helper = new Thread("once", 1);
+
+    ASSERT(!done);			// otherwise test won't work!
+    testOnce = this;
+    onceNumRuns = 0;
+    onceHelperDone = FALSE;
+
+    helper->Fork((VoidFunctionPtr) OnceSelfTestHelper, NULL);
+    Run((VoidFunctionPtr) OnceSelfTestInit, NULL);
+    ASSERT(onceNumRuns == 1);
+    while (!onceHelperDone) {
+	self->Yield();
+    }
+    Run((VoidFunctionPtr) OnceSelfTestInit, NULL);
+    ASSERT(onceNumRuns == 1 && numCalls == 3 && numWaits == 1);
+}
+
+//----------------------------------------------------------------------
+// Barrier::Barrier
+// 	Initialize a barrier that no thread has reached yet.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"threads" is the number of threads that use the barrier
+//----------------------------------------------------------------------
+
+Barrier::Barrier(char* debugName, int threads)
+{
+    ASSERT(threads > 0);
+    name = debugName;
+    numThreads = threads;
+    lock = new Lock("barrier");
+    allHere = new Condition("barrier");
+    numArrived = 0;
+    generation = 0;
+    numWaits = 0;
+}
+
+//----------------------------------------------------------------------
+// Barrier::~Barrier
+// 	Deallocate a barrier.  Assume no one is waiting at it!
+//----------------------------------------------------------------------
+
+Barrier::~Barrier()
+{
+    ASSERT(numArrived == 0);
+    delete allHere;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// Barrier::Wait
+// 	Wait until all the threads have reached the barrier.  The last
+//	one to arrive wakes the others, and starts the next round.  A
+//	waiter checks the generation, not the count, so it can't be
+//	confused by threads that have already arrived for the next
+//	round.
+//----------------------------------------------------------------------
+
+void
+Barrier::Wait()
+{
+    int myGeneration;
+
+    lock->Acquire();
+    myGeneration = generation;
+    if (++numArrived == numThreads) {
+	numArrived = 0;
+	generation++;
+	allHere->Broadcast(lock);
+    } else {
+	numWaits++;
+	while (generation == myGeneration) {
+	    allHere->Wait(lock);
+	}
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Barrier::Print
+// 	Print how many times all the threads got through the barrier,
+//	and how many threads had to wait for the others.
+//----------------------------------------------------------------------
+
+void
+Barrier::Print()
+{
+    cout << name << ": " << generation << " rounds (" << numWaits
+	<< " waited)\n";
+}
+
+//----------------------------------------------------------------------
+// Barrier::SelfTest, BarrierSelfTestHelper
+// 	Test the barrier implementation.  The test thread and its
+//	helpers go through several rounds, each one counting itself in
+//	before the barrier; after the barrier, all of them must have.
+//----------------------------------------------------------------------
+
+static const int BarrierRounds = 3;
+static Barrier *testBarrier;
+static int barrierCount;
+static int barrierNumDone;
+
+static void
+BarrierSelfTestHelper(void *arg)
+{
+    int numThreads = *(int *) arg;
+
+    for (int round = 1; round <= BarrierRounds; round++) {
+	barrierCount++;
+	testBarrier->Wait();
+	ASSERT(barrierCount >= round * numThreads);
+	testBarrier->Wait();		// no one starts the next round
+    }					// before everyone has checked
+    barrierNumDone++;
+}
+
+void
+Barrier::SelfTest()
+{
+    ASSERT(numArrived == 0 && generation == 0);	// otherwise test
+    testBarrier = this;				// won't work!
+    barrierCount = 0;
+    barrierNumDone = 0;
+
+    for (int i = 1; i < numThreads; i++) {
+	(new Thread("barrier", 1))->Fork(
+		(VoidFunctionPtr) BarrierSelfTestHelper, &numThreads);
+    }
+    BarrierSelfTestHelper(&numThreads);
+    while (barrierNumDone < numThreads) {	// let the helpers get
+	kernel->currentThread->Yield();		// out of Wait
     }
+    ASSERT(barrierCount == BarrierRounds * numThreads);
+    ASSERT(generation == 2 * BarrierRounds);
 }
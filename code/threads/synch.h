@@ -7,8 +7,17 @@
 //	interface is given -- they are to be implemented as part of 
 //	the first assignment.
 //
+//	Built on these are reader-writer locks and sequence locks, for
+//	data that is read much more often than it is written, and
+//	"once" and barrier objects, for initialization and for threads
+//	that work in phases.
+//
 //	Note that all the synchronization objects take a "name" as
-//	part of the initialization.  This is solely for debugging purposes.
+//	part of the initialization.  This is solely for debugging purposes,
+//	and for profiling: when Nachos is run with "-ps", semaphores,
+//	locks and condition variables count how often threads wait for
+//	them, and for how long, under their name (see SynchRecord).
+//	Otherwise, all this costs is a test for a NULL record.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -50,8 +59,9 @@ class Semaphore {
   private:
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
-    List<Thread *> *queue;     
+    ThreadQueue *queue;     
 		  	// threads waiting in P() for the value to be > 0
+    SynchRecord *record;	// contention counters, if profiling
    };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -65,6 +75,15 @@ class Semaphore {
 // In addition, by convention, only the thread that acquired the lock
 // may release it.  As with semaphores, you can't read the lock value
 // (because the value might change immediately after you read it).  
+//
+// To avoid priority inversion, a thread that has to wait for a lock
+// donates its priority to the thread holding it -- and, if that
+// thread is itself waiting for a lock, to the holder of that one, and
+// so on down the chain -- until the lock is released (see
+// Scheduler::Reprioritize).  The lock goes to the most important
+// thread waiting for it, first come first served among equals.
+// Only the FIFO and MLFQ schedulers run threads in priority order;
+// under the others, nothing is donated.
 
 class Lock {
   public:
@@ -75,17 +94,35 @@ class Lock {
     void Acquire(); 		// these are the only operations on a lock
     void Release(); 		// they are both *atomic*
 
+    bool IsHeld() { return lockHolder != NULL; }
+				// does any thread hold the lock?
     bool IsHeldByCurrentThread() { 
     		return lockHolder == kernel->currentThread; }
     				// return true if the current thread 
 				// holds this lock.
     
-    // Note: SelfTest routine provided by SynchList
+    void SelfTest();		// test priority inheritance; the rest
+				// is tested by SynchList
     
   private:
     char *name;			// debugging assist
     Thread *lockHolder;		// thread currently holding lock
-    Semaphore *semaphore;	// we use a semaphore to implement lock
+    ThreadQueue *queue;		// threads waiting in Acquire()
+    Lock *nextHeld;		// next lock held by "lockHolder"
+    SynchRecord *record;	// contention counters, if profiling
+    int acquiredAt;		// when "lockHolder" got the lock, if
+				// profiling
+
+    static int DonatedTo(Thread* thread);
+				// best priority among the threads
+				// waiting for locks "thread" holds
+    void Donate(Thread* donor);	// raise the priority of the holder
+				// (and whoever it waits for) to that
+				// of "donor"
+    int WaiterPriority();	// best priority among the waiters
+    Thread *BestWaiter();	// the waiter to get the lock next
+    void Unlink();		// take the lock off its holder's
+				// list of held locks
 };
 
 // The following class defines a "condition variable".  A condition
@@ -139,6 +176,152 @@ class Condition {
 
   private:
     char* name;
-    List<Semaphore *> *waitQueue;	// list of waiting threads
+    ThreadQueue *waitQueue;		// threads waiting in Wait();
+					// queuing one allocates nothing
+    SynchRecord *record;		// contention counters, if profiling
+};
+
+// The following class defines a "reader-writer lock".  Any number of
+// threads may hold it for reading at once, but a thread holding it
+// for writing has it to itself.
+//
+//	AcquireRead -- wait until no thread is writing, then read
+//
+//	AcquireWrite -- wait until no thread is reading or writing,
+//		then write
+//
+// The lock is fair: threads get it in the order they asked for it, so
+// a steady stream of readers can't starve a writer (a reader that
+// arrives after a waiting writer waits behind it), and readers that
+// are next in line get the lock together.
+
+class RWLock {
+  public:
+    RWLock(char* debugName);	// initialize lock to be FREE
+    ~RWLock();			// deallocate lock
+    char* getName() { return name; }	// debugging assist
+
+    void AcquireRead();		// wait until we may read
+    void ReleaseRead();		// done reading
+    void AcquireWrite();	// wait until we may write
+    void ReleaseWrite();	// done writing
+
+    void Print();		// print contention counters
+    void SelfTest();		// test routine for reader-writer locks
+
+  private:
+    char* name;			// debugging assist
+    Lock *lock;			// protects the fields below
+    Condition *turn;		// wait here for our turn to come
+    int nextTicket;		// ticket for the next thread to ask
+    int nowServing;		// ticket of the thread whose turn it is
+    int numReaders;		// # of threads reading now
+    bool writing;		// is a thread writing now?
+
+    int numReads;		// # of times acquired for reading
+    int numWrites;		// # of times acquired for writing
+    int numReadWaits;		// # of those reads that had to wait
+    int numWriteWaits;		// # of those writes that had to wait
+};
+
+// The following class defines a "sequence lock", for data that is
+// read often and written rarely.  Writers exclude each other, but
+// readers never wait for a writer, or hold anything up; instead, they
+// check afterward whether a writer got in the way, and if so, read
+// again:
+//
+//	do {
+//	    seq = seqLock->ReadBegin();
+//	    ... copy the data ...
+//	} while (seqLock->ReadRetry(seq));
+//
+// A reader must not act on what it reads until ReadRetry says it
+// was consistent.
+
+class SeqLock {
+  public:
+    SeqLock(char* debugName);	// initialize lock, with no writer
+    ~SeqLock();			// deallocate lock
+    char* getName() { return name; }	// debugging assist
+
+    unsigned int ReadBegin();	// start reading; returns the sequence
+				// number to pass to ReadRetry
+    bool ReadRetry(unsigned int seq);
+				// did a writer change the data since
+				// ReadBegin returned "seq"?
+    void WriteBegin();		// wait for other writers, then write
+    void WriteEnd();		// done writing
+
+    void Print();		// print contention counters
+    void SelfTest();		// test routine for sequence locks
+
+  private:
+    char* name;			// debugging assist
+    Lock *writeLock;		// lets in one writer at a time
+    volatile unsigned int sequence;
+				// # of times writers have started or
+				// finished; odd while one is writing
+
+    int numReads;		// # of reads begun
+    int numRetries;		// # of reads that had to be retried
+    int numWrites;		// # of writes
+};
+
+// The following class defines a "once" object, which runs a function
+// (typically, an initialization routine) exactly once, however many
+// threads call it.  Threads that call it while the function is still
+// running wait for it to finish.
+
+class Once {
+  public:
+    Once(char* debugName);	// initialize: the function hasn't run
+    ~Once();			// deallocate
+    char* getName() { return name; }	// debugging assist
+
+    void Run(VoidFunctionPtr func, void *arg);
+				// call (*func)(arg), unless that has
+				// been done already
+
+    void Print();		// print contention counters
+    void SelfTest();		// test routine for once objects
+
+  private:
+    char* name;			// debugging assist
+    Lock *lock;			// held while the function runs
+    volatile bool done;		// has the function finished?
+
+    int numCalls;		// # of calls to Run
+    int numWaits;		// # of calls that waited for the
+				// function to finish
+};
+
+// The following class defines a "barrier" for a fixed number of
+// threads.  Each thread that reaches the barrier (calls Wait) waits
+// until all of them have; then they all go on, and the barrier can be
+// used again.
+
+class Barrier {
+  public:
+    Barrier(char* debugName, int numThreads);
+				// initialize a barrier for "numThreads"
+    ~Barrier();			// deallocate the barrier
+    char* getName() { return name; }	// debugging assist
+
+    void Wait();		// wait for the other threads
+
+    void Print();		// print contention counters
+    void SelfTest();		// test routine for barriers
+
+  private:
+    char* name;			// debugging assist
+    int numThreads;		// # of threads that must reach it
+    Lock *lock;			// protects the fields below
+    Condition *allHere;		// wait here for the others
+    int numArrived;		// # of threads that have reached it,
+				// this time around
+    int generation;		// # of times all threads have reached
+				// it
+
+    int numWaits;		// # of threads that had to wait
 };
 #endif // SYNCH_H
@@ -21,6 +21,7 @@
 #include "switch.h"
 #include "synch.h"
 #include "sysdep.h"
+#include "threadpool.h"
 
 // this is put at the top of the execution stack, for detecting stack overflows
 const int STACK_FENCEPOST = 0xdedbeef;
@@ -40,12 +41,86 @@ Thread::Thread(char* threadName, int threadID)
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
+    priority = 0;
+    donatedPriority = NumPriorities;
+    queuedLevel = -1;
+    heldLocks = waitingFor = NULL;
+    slicesUsed = 0;
+    burstStart = 0;
+    userInstrs = 0;
+    preempted = FALSE;
+    predictedBurst = SJFInitialBurst;
+    tickets = DefaultTickets;
+    pass = 0;
+    cpuTicks = 0;
+    readySince = 0;
+    quota = NULL;
+    quantum = TimerTicks;
+    cpu = -1;
+    rtPeriod = rtBudget = rtDeadline = rtUsed = 0;
+    rtPeriods = deadlineMisses = budgetOverruns = 0;
     for (int i = 0; i < MachineStateSize; i++) {
 	machineState[i] = NULL;		// not strictly necessary, since
 					// new thread ignores contents 
 					// of machine registers
     }
     space = NULL;
+    userFunc = userStack = userReturn = 0;
+}
+
+//----------------------------------------------------------------------
+// Thread::Reset
+// 	Re-initialize the control block of a thread that has finished,
+//	so that it can be Fork'ed again (see threadpool.h).  The stack,
+//	if any, is kept, and is re-initialized by the next Fork.
+//
+//	"threadName" is an arbitrary string, useful for debugging.
+//	"threadID" is the new thread's identifier.
+//----------------------------------------------------------------------
+
+void
+Thread::Reset(char* threadName, int threadID)
+{
+    ASSERT(this != kernel->currentThread);
+    ID = threadID;
+    name = threadName;
+    stackTop = NULL;
+    status = JUST_CREATED;
+    priority = 0;
+    donatedPriority = NumPriorities;
+    queuedLevel = -1;
+    heldLocks = waitingFor = NULL;
+    slicesUsed = 0;
+    burstStart = 0;
+    userInstrs = 0;
+    preempted = FALSE;
+    predictedBurst = SJFInitialBurst;
+    tickets = DefaultTickets;
+    pass = 0;
+    cpuTicks = 0;
+    readySince = 0;
+    quota = NULL;
+    quantum = TimerTicks;
+    cpu = -1;
+    rtPeriod = rtBudget = rtDeadline = rtUsed = 0;
+    rtPeriods = deadlineMisses = budgetOverruns = 0;
+    account.Clear();
+    space = NULL;
+    userFunc = userStack = userReturn = 0;
+}
+
+//----------------------------------------------------------------------
+// Thread::AllocateStack
+// 	Get an execution stack from the kernel's pool of stacks (see
+//	threadpool.h), unless we already have one.
+//----------------------------------------------------------------------
+
+void
+Thread::AllocateStack()
+{
+    if (stack == NULL) {
+	stack = kernel->threadPool->GetStack();
+    }
 }
 
 //----------------------------------------------------------------------
@@ -64,8 +139,9 @@ Thread::~Thread()
 {
     DEBUG(dbgThread, "Deleting thread: " << name);
     ASSERT(this != kernel->currentThread);
+    ASSERT(queueLink.list == NULL);	// not still waiting on a queue
     if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	kernel->threadPool->PutStack(stack);	// keep it for reuse
 }
 
 //----------------------------------------------------------------------
@@ -212,6 +288,10 @@ Thread::Finish ()
 //	Otherwise returns when the thread eventually works its way
 //	to the front of the ready list and gets re-scheduled.
 //
+//	The exception is a thread whose program has used up its CPU
+//	quota: it is throttled (see Scheduler::ReadyToRun), and gives
+//	up the CPU even if that leaves it idle until the next period.
+//
 //	NOTE: we disable interrupts, so that looking at the thread
 //	on the front of the ready list, and switching to it, can be done
 //	atomically.  On return, we re-set the interrupt level to its
@@ -233,7 +313,13 @@ Thread::Yield ()
     DEBUG(dbgThread, "Yielding thread: " << name);
     
     nextThread = kernel->scheduler->FindNextToRun();
-    if(nextThread != NULL){
+    if (nextThread == NULL && kernel->scheduler->OverQuota(this)) {
+	kernel->scheduler->ReadyToRun(this);	// throttles us
+	while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL) {
+	    kernel->interrupt->Idle();	// wait for the next period
+	}
+	kernel->scheduler->Run(nextThread, FALSE);
+    } else if(nextThread != NULL){
 
         /***************************************/
         // cout << "\tthis = " << this->getName() << endl;
@@ -345,7 +431,9 @@ PLabelToAddr(void *plabel)
 
 //----------------------------------------------------------------------
 // Thread::StackAllocate
-//	Allocate and initialize an execution stack.  The stack is
+//	Allocate and initialize an execution stack.  A thread that
+//	is being reused (see Thread::Reset) already has a stack, and
+//	only needs it re-initialized.  The stack is
 //	initialized with an initial stack frame for ThreadRoot, which:
 //		enables interrupts
 //		calls (*func)(arg)
@@ -358,7 +446,7 @@ PLabelToAddr(void *plabel)
 void
 Thread::StackAllocate (VoidFunctionPtr func, void *arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    AllocateStack();
 
 #ifdef PARISC
     // HP stack works from low addresses to high addresses
@@ -414,6 +502,84 @@ Thread::StackAllocate (VoidFunctionPtr func, void *arg)
 #endif
 }
 
+//----------------------------------------------------------------------
+// CPUAccount::Clear
+// 	Zero all the counts of an account.
+//----------------------------------------------------------------------
+
+void
+CPUAccount::Clear()
+{
+    userTicks = systemTicks = readyTicks = 0;
+    voluntarySwitches = involuntarySwitches = 0;
+    for (int i = 0; i < NumLatencyBuckets; i++) {
+	latencies[i] = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// CPUAccount::Add
+// 	Add the counts of another account (say, of a thread that has
+//	exited) to this one.
+//
+//	"other" is the account to add in
+//----------------------------------------------------------------------
+
+void
+CPUAccount::Add(CPUAccount *other)
+{
+    userTicks += other->userTicks;
+    systemTicks += other->systemTicks;
+    readyTicks += other->readyTicks;
+    voluntarySwitches += other->voluntarySwitches;
+    involuntarySwitches += other->involuntarySwitches;
+    for (int i = 0; i < NumLatencyBuckets; i++) {
+	latencies[i] += other->latencies[i];
+    }
+}
+
+//----------------------------------------------------------------------
+// CPUAccount::RecordLatency
+// 	Count a wait on a ready queue: add it to the time spent ready,
+//	and to the right bucket of the latency histogram.
+//
+//	"ticks" is how long the thread waited for a CPU
+//----------------------------------------------------------------------
+
+void
+CPUAccount::RecordLatency(int ticks)
+{
+    int bucket = 0;
+
+    readyTicks += ticks;
+    while (bucket < NumLatencyBuckets - 1
+			&& ticks >= (LatencyBucketTicks << bucket)) {
+	bucket++;
+    }
+    latencies[bucket]++;
+}
+
+//----------------------------------------------------------------------
+// CPUAccount::Print
+// 	Print the counts of an account, along with the histogram of
+//	ready-to-run latencies.
+//----------------------------------------------------------------------
+
+void
+CPUAccount::Print()
+{
+    cout << "  ticks: user " << userTicks << ", system " << systemTicks
+	<< ", ready " << readyTicks << "\n";
+    cout << "  switches: voluntary " << voluntarySwitches
+	<< ", involuntary " << involuntarySwitches << "\n";
+    cout << "  ready latency:";
+    for (int i = 0; i < NumLatencyBuckets - 1; i++) {
+	cout << " <" << (LatencyBucketTicks << i) << ": " << latencies[i]
+	    << ",";
+    }
+    cout << " more: " << latencies[NumLatencyBuckets - 1] << "\n";
+}
+
 #include "machine.h"
 
 //----------------------------------------------------------------------
@@ -439,15 +605,64 @@ Thread::SaveUserState()
 //	Note that a user program thread has *two* sets of CPU registers -- 
 //	one for its state while executing user code, one for its state 
 //	while executing kernel code.  This routine restores the former.
+//
+//	The registers are not saved when a thread is switched out, only
+//	when another user program needs the machine (see ClaimUserState),
+//	so if nobody else has run user code since, they are still there,
+//	and there is nothing to do.
+//
+//	Each CPU has its own registers, so they are only still there if
+//	we are back on the same CPU; if we have moved, they are fetched
+//	from the CPU we left them on.
 //----------------------------------------------------------------------
 
 void
 Thread::RestoreUserState()
 {
+    if (kernel->machine->registerOwner == this) {
+	return;				// never left the machine
+    }
+    kernel->machine->FetchRegisters(this, userRegisters);
+					// in case we were last on
+					// another CPU
+    ClaimUserState();
     for (int i = 0; i < NumTotalRegs; i++)
 	kernel->machine->WriteRegister(i, userRegisters[i]);
 }
 
+//----------------------------------------------------------------------
+// Thread::ClaimUserState
+//	Make the machine's user registers ours, first saving them for
+//	the thread they belong to, if any.  The caller is about to
+//	overwrite them.
+//----------------------------------------------------------------------
+
+void
+Thread::ClaimUserState()
+{
+    Thread *owner = kernel->machine->registerOwner;
+
+    if (owner != this) {
+	if (owner != NULL) {
+	    owner->SaveUserState();
+	}
+	kernel->machine->registerOwner = this;
+    }
+}
+
+//----------------------------------------------------------------------
+// Thread::ReleaseUserState
+//	We are finished with user code; if our registers are still on
+//	any CPU, forget about them, so that nobody saves them into
+//	a thread that no longer exists.
+//----------------------------------------------------------------------
+
+void
+Thread::ReleaseUserState()
+{
+    kernel->machine->Forget(this);
+}
+
 
 //----------------------------------------------------------------------
 // SimpleThread
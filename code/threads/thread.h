@@ -42,6 +42,10 @@
 #include "sysdep.h"
 #include "machine.h"
 #include "addrspace.h"
+#include "intrusivelist.h"
+
+class Lock;
+class CPUQuota;
 
 // CPU register state to be saved on context switch.  
 // The x86 needs to save only a few registers, 
@@ -62,6 +66,39 @@ const int StackSize = (8 * 1024);	// in words
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED, ZOMBIE };
 
 
+// Ready-to-run latency (how long a thread waits on a ready queue
+// before it gets a CPU) is counted in buckets: bucket i holds the waits
+// shorter than LatencyBucketTicks << i ticks that don't fit in bucket
+// i - 1; the last bucket holds all the longer ones.
+const int NumLatencyBuckets = 8;
+const int LatencyBucketTicks = 32;
+
+// The following class defines the CPU accounting of a thread -- or,
+// added up, of the threads of a user program.
+
+class CPUAccount {
+  public:
+    CPUAccount() { Clear(); }	// start with nothing counted
+    void Clear();		// zero all the counts
+    void Add(CPUAccount *other);// add in another account's counts
+    void RecordLatency(int ticks);
+				// the thread waited "ticks" on a ready
+				// queue before it got a CPU
+    void Print();		// print the counts
+
+    int userTicks;		// time spent running user code
+    int systemTicks;		// time spent running kernel code
+    int readyTicks;		// time spent ready, waiting for a CPU
+    int voluntarySwitches;	// # of times the thread gave up the
+				// CPU itself: to wait for something,
+				// or by calling Yield
+    int involuntarySwitches;	// # of times it was preempted: it
+				// gave up the CPU on a timer interrupt,
+				// or for a more important thread
+    int latencies[NumLatencyBuckets];
+				// # of waits for a CPU in each bucket
+};
+
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
 //
@@ -97,6 +134,13 @@ class Thread {
 				// relinquish the processor
     void Begin();		// Startup code for the thread	
     void Finish();  		// The thread is done executing
+
+    void Reset(char* debugName, int threadID);
+				// Re-initialize a finished thread, so
+				// it can be Fork'ed again; keeps the stack
+    void AllocateStack();	// Allocate the stack now, instead of
+				// when the thread is Fork'ed
+    bool HasStack() { return (stack != NULL); }
     
     void CheckOverflow();   	// Check if thread stack has overflowed
     void setStatus(ThreadStatus st) { status = st; }
@@ -104,6 +148,62 @@ class Thread {
 	char* getName() { return (name); }
     
 	int getID() { return (ID); }
+
+    int getPriority() { return (priority); }
+    void setPriority(int level) { priority = level; }
+    int getEffectivePriority() { return min(priority, donatedPriority); }
+				// the level we are scheduled at: our
+				// own, or that of a more important
+				// thread waiting for a lock we hold
+    int donatedPriority;	// best level among threads waiting for
+				// locks we hold; NumPriorities if none
+    int queuedLevel;		// effective priority we were queued
+				// at, on a CPU's run queue (FIFO); -1
+				// if we aren't on one
+    Lock *heldLocks;		// locks we hold, linked through
+				// Lock::nextHeld
+    Lock *waitingFor;		// lock we are waiting to acquire, or
+				// NULL
+    int slicesUsed;		// timer interrupts this thread has run
+				// through at its current level (MLFQ)
+    int burstStart;		// when (in busy ticks) this thread last
+				// got the CPU; -1 if it isn't running
+    int userInstrs;		// user instructions it has executed
+				// since then (see Machine::Run)
+    bool preempted;		// is the current Yield a preemption
+				// (see Interrupt::OneTick)?
+    double predictedBurst;	// how long we expect its next CPU
+				// burst to be (SJF)
+    int getTickets() { return (tickets); }
+    void setTickets(int n) { tickets = n; }	// must be > 0
+    double pass;		// service received, scaled by tickets
+				// (STRIDE)
+    int cpuTicks;		// total ticks this thread has run
+    int quantum;		// how long it may run before being
+				// preempted, in ticks (adapts to how
+				// the thread behaves)
+    int cpu;			// CPU it is running on, or last ran
+				// on (or is queued on); -1 if none yet
+    CPUAccount account;		// where this thread's time went
+    CPUQuota *quota;		// CPU quota of our program, or NULL
+    int readySince;		// when it was last put on a ready queue
+
+    bool isRealTime() { return (rtPeriod > 0); }
+    int rtPeriod;		// real-time period, in ticks; 0 if the
+				// thread is in the normal class
+    int rtBudget;		// CPU ticks it may use each period
+    int rtDeadline;		// end of the current period
+    int rtUsed;			// CPU ticks used this period
+    int rtPeriods;		// # of periods so far
+    int deadlineMisses;		// # of periods that ended before the
+				// thread got its budget
+    int budgetOverruns;		// # of periods in which the thread
+				// wanted more than its budget
+    IntrusiveLink<Thread> queueLink;
+				// links us into whichever queue we are
+				// waiting on -- ready, semaphore, or
+				// thread pool; a thread waits on at
+				// most one queue at a time
     void Print() { cout << name; }
     void SelfTest();		// test whether thread impl is working
 
@@ -116,6 +216,10 @@ class Thread {
     ThreadStatus status;	// ready, running or blocked
     char* name;
 	int   ID;
+    int priority;		// our own priority (under MLFQ, our
+				// level); 0 is the highest
+    int tickets;		// share of the CPU we are entitled to
+				// (STRIDE, LOTTERY)
     void StackAllocate(VoidFunctionPtr func, void *arg);
     				// Allocate a stack for thread.
 				// Used internally by Fork()
@@ -128,11 +232,27 @@ class Thread {
 
   public:
     void SaveUserState();		// save user-level register state
-    void RestoreUserState();		// restore user-level register state
+    void RestoreUserState();		// restore user-level register state,
+					// unless it is still in the machine
+    void ClaimUserState();		// take over the machine's user
+					// registers, saving their owner's
+    void ReleaseUserState();		// our user registers are no
+					// longer needed
 
     AddrSpace *space;			// User code this thread is running.
+    int userFunc;			// where a thread forked by a user
+    int userStack;			// program starts, the top of its
+    int userReturn;			// user stack, and where "userFunc"
+					// returns to (see ThreadFork)
 };
 
+// Queues of threads, linked through Thread::queueLink; putting a thread
+// on one of these, or taking it off, never allocates memory.
+
+typedef IntrusiveList<Thread, &Thread::queueLink> ThreadQueue;
+typedef IntrusiveSortedList<Thread, &Thread::queueLink> SortedThreadQueue;
+typedef IntrusiveListIterator<Thread, &Thread::queueLink> ThreadQueueIterator;
+
 // external function, dummy routine whose sole job is to call Thread::Print
 extern void ThreadPrint(Thread *thread);	 
 
@@ -0,0 +1,166 @@
+// threadpool.cc
+//	Routines to recycle thread control blocks and their stacks.
+//
+//	These routines assume that interrupts are already disabled, or
+//	that they are only called before any other thread runs --
+//	Put is called from Scheduler::CheckToBeDestroyed.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "threadpool.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// ThreadPool::ThreadPool
+// 	Initialize the pool, and fill it with threads, and with stacks
+//	for them to run on.  (The threads pick up their stacks when
+//	they are first Fork'ed.)
+//
+//	"initialSize" is the number of threads and stacks to allocate
+//		up front
+//	"maxSize" is the most unused threads we keep at once
+//	"maxStacks" is the most unused stacks we keep at once
+//----------------------------------------------------------------------
+
+ThreadPool::ThreadPool(int initialSize, int maxSize, int maxStacks)
+{
+    freeThreads = new ThreadQueue;
+    maxFree = maxSize;
+    numReused = numCreated = 0;
+    for (int i = 0; i < initialSize && i < maxSize; i++) {
+	freeThreads->Append(new Thread("pooled", -1));
+    }
+
+    maxFreeStacks = maxStacks;
+    freeStacks = new int *[maxFreeStacks];
+    numFreeStacks = 0;
+    for (int i = 0; i < initialSize && i < maxFreeStacks; i++) {
+	freeStacks[numFreeStacks++] =
+		(int *) AllocBoundedArray(StackSize * sizeof(int));
+    }
+    kernel->stats->numPooledStacks = numFreeStacks;
+}
+
+//----------------------------------------------------------------------
+// ThreadPool::~ThreadPool
+// 	De-allocate the pool, every unused thread in it, and every
+//	unused stack.
+//----------------------------------------------------------------------
+
+ThreadPool::~ThreadPool()
+{
+    while (!freeThreads->IsEmpty()) {
+	delete freeThreads->RemoveFront();	// stack goes to the pool
+    }
+    delete freeThreads;
+    while (numFreeStacks > 0) {
+	DeallocBoundedArray((char *) freeStacks[--numFreeStacks],
+					StackSize * sizeof(int));
+    }
+    delete [] freeStacks;
+}
+
+//----------------------------------------------------------------------
+// ThreadPool::Get
+// 	Return a thread control block, ready to be Fork'ed.  If the
+//	pool is empty, a new thread is allocated as usual.
+//
+//	"debugName" is the name of the thread, for debugging
+//	"threadID" is the thread's identifier
+//----------------------------------------------------------------------
+
+Thread *
+ThreadPool::Get(char *debugName, int threadID)
+{
+    Thread *thread;
+
+    if (freeThreads->IsEmpty()) {
+	numCreated++;
+	return new Thread(debugName, threadID);
+    }
+    thread = freeThreads->RemoveFront();
+    thread->Reset(debugName, threadID);
+    numReused++;
+    if (thread->HasStack()) {
+	kernel->stats->numStackHits++;	// no need for GetStack
+    }
+    DEBUG(dbgThread, "Reusing pooled thread for: " << debugName << " ("
+		<< numReused << " reused, " << numCreated << " created)");
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// ThreadPool::Put
+// 	Take back a thread that has finished.  The scheduler gets to
+//	record its statistics first (see Scheduler::Retire), and its
+//	address space, if any, is de-allocated now; its stack is kept
+//	for the next thread.
+//
+//	"thread" is the finished thread; it must not be running
+//----------------------------------------------------------------------
+
+void
+ThreadPool::Put(Thread *thread)
+{
+    ASSERT(thread != kernel->currentThread);
+
+    DEBUG(dbgThread, "Returning thread to pool: " << thread->getName());
+    kernel->scheduler->Retire(thread);
+    thread->ReleaseUserState();
+    if (thread->space != NULL) {	// the thread's name may belong
+	if (thread->space->Detach()) {	// to its address space
+	    delete thread->space;
+	}
+	thread->space = NULL;
+    }
+    thread->Reset("pooled", -1);
+    if (freeThreads->NumInList() >= (unsigned int) maxFree) {
+	delete thread;
+	return;
+    }
+    freeThreads->Prepend(thread);	// most recently used stack first
+}
+
+//----------------------------------------------------------------------
+// ThreadPool::GetStack
+// 	Return a stack of StackSize words, with guard pages on either
+//	side (see AllocBoundedArray).  The stack freed most recently is
+//	reused first, since it is the most likely to still be cached;
+//	if there is none, a new one is allocated.
+//----------------------------------------------------------------------
+
+int *
+ThreadPool::GetStack()
+{
+    if (numFreeStacks == 0) {
+	kernel->stats->numStackMisses++;
+	return (int *) AllocBoundedArray(StackSize * sizeof(int));
+    }
+    kernel->stats->numStackHits++;
+    kernel->stats->numPooledStacks = numFreeStacks - 1;
+    return freeStacks[--numFreeStacks];
+}
+
+//----------------------------------------------------------------------
+// ThreadPool::PutStack
+// 	Take back the stack of a thread that is being deleted.  It must
+//	not be in use any more -- threads that finish are only deleted
+//	once we are running on another stack (see
+//	Scheduler::CheckToBeDestroyed).
+//
+//	"stack" is a stack returned by GetStack
+//----------------------------------------------------------------------
+
+void
+ThreadPool::PutStack(int *stack)
+{
+    if (numFreeStacks >= maxFreeStacks) {
+	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	return;
+    }
+    freeStacks[numFreeStacks++] = stack;
+    kernel->stats->numPooledStacks = numFreeStacks;
+}
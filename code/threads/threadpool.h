@@ -0,0 +1,70 @@
+// threadpool.h
+//	Data structures for recycling thread control blocks.
+//
+//	Creating a thread means allocating a Thread object and an
+//	execution stack of StackSize words; for programs that start
+//	many short-lived children, that cost dominates.  Instead, a
+//	finished thread is handed back to the pool (by the scheduler,
+//	once we are no longer running on its stack), and the next
+//	thread to be created reuses both the object and its stack.
+//
+//	Stacks are also pooled on their own.  A stack comes from
+//	AllocBoundedArray, which has to mprotect a guard page on each
+//	side of it (and undo that when it is freed); a thread that
+//	doesn't come from the pool, or that is deleted because the pool
+//	of threads is full, still takes its stack from, and gives it
+//	back to, the pool of stacks.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include "copyright.h"
+#include "thread.h"
+
+// Threads allocated (with stacks) when the kernel starts up.
+const int InitialPooledThreads = 4;
+
+// Most finished threads we keep around for reuse; beyond this,
+// finished threads are simply deleted.
+const int MaxPooledThreads = 32;
+
+// Most unused stacks we keep around; beyond this, stacks are freed.
+const int MaxPooledStacks = 64;
+
+// The following class defines a pool of unused threads.
+
+class ThreadPool {
+  public:
+    ThreadPool(int initialSize, int maxSize, int maxStacks);
+				// preallocate "initialSize" threads
+				// and stacks
+    ~ThreadPool();		// de-allocate every pooled thread
+
+    Thread *Get(char *debugName, int threadID);
+				// return a thread ready to be Fork'ed,
+				// reusing a pooled one if possible
+    void Put(Thread *thread);	// "thread" has finished; keep it
+				// for reuse, or delete it if the
+				// pool is full
+
+    int *GetStack();		// return a guarded stack of StackSize
+				// words, reusing a pooled one if possible
+    void PutStack(int *stack);	// "stack" is no longer used; keep it
+				// for reuse, or free it if the pool
+				// is full
+
+  private:
+    ThreadQueue *freeThreads;	// finished threads, ready for reuse
+    int maxFree;		// how many we keep at most
+    int **freeStacks;		// unused stacks, most recently used last
+    int numFreeStacks;		// # of stacks on "freeStacks"
+    int maxFreeStacks;		// how many we keep at most
+    int numReused;		// # of Get's satisfied from the pool
+    int numCreated;		// # of Get's that had to allocate
+};
+
+#endif // THREADPOOL_H
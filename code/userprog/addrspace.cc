@@ -6,7 +6,9 @@
 //	1. link with the -n -T 0 option 
 //	2. run coff2noff to convert the object file to Nachos format
 //		(Nachos object code format is essentially just a simpler
-//		version of the UNIX executable object code format)
+//		version of the UNIX executable object code format);
+//		a 32-bit little endian MIPS ELF executable can instead
+//		be loaded as is
 //	3. load the NOFF file into the Nachos file system
 //		(if you are using the "stub" file system, you
 //		don't need to do this last step)
@@ -20,6 +22,13 @@
 #include "addrspace.h"
 #include "machine.h"
 #include "noff.h"
+#include "elf.h"
+#include "execcache.h"
+#include "synch.h"
+
+// A paged NOFF file is laid out one Nachos page per NOFFPAGESIZE bytes,
+// so the two must agree; refuse to compile if they don't.
+typedef char NoffPageSizeCheck[(NOFFPAGESIZE == PageSize) ? 1 : -1];
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -67,6 +76,16 @@ SwapHeader (NoffHeader *noffH)
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace(){
+    pageTable = NULL;
+    numPages = 0;
+    entryPoint = 0;
+    numArgs = 0;
+    args = NULL;
+    threads = new List<UserThread *>;
+    nextThreadID = 0;
+    numRunning = numRefs = 0;
+    freeStacks = new List<int>;
+    exitStatus = 0;
 }
 
 //----------------------------------------------------------------------
@@ -79,186 +98,431 @@ AddrSpace::~AddrSpace(){
         kernel->usedPhyPage->pages[pageTable[i].physicalPage] = 0;
     
 
-   delete pageTable;
+   kernel->machine->Forget(this);	// no CPU may keep using it
+   delete [] pageTable;
+   for (int i = 0; i < numArgs; i++)
+	delete [] args[i];
+   delete [] args;
+   ASSERT(numRunning == 0 && numRefs == 0);
+   while (!threads->IsEmpty())		// exited, but never joined
+	delete threads->RemoveFront();
+   delete threads;
+   delete freeStacks;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SetArguments
+// 	Remember the arguments the program is to be started with.  We
+//	make our own copy, so the caller may free its strings.
+//
+//	Returns FALSE if the arguments take up too much of the stack.
+//
+//	"argc" is the number of arguments, including the program name
+//	"argv" is the arguments; argv[0] is the program name
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::SetArguments(int argc, char **argv)
+{
+    int size = (argc + 1) * sizeof(int);	// the argv[] array itself
+
+    ASSERT(numArgs == 0 && argc > 0);
+    for (int i = 0; i < argc; i++) {
+	size += strlen(argv[i]) + 1;
+    }
+    if (size > UserStackSize / 2) {	// leave the program some stack!
+	return FALSE;
+    }
+    numArgs = argc;
+    args = new char *[argc];
+    for (int i = 0; i < argc; i++) {
+	args[i] = new char[strlen(argv[i]) + 1];
+	strcpy(args[i], argv[i]);
+    }
+    return TRUE;
 }
 
 
 //----------------------------------------------------------------------
-// AddrSpace::Load
-// 	Load a user program into memory from a file.
+// ReadSegment
+// 	Copy one segment of an executable file into its place in the
+//	in-memory image of the program.
+//
+//	"executable" is the open executable file
+//	"seg" is the segment to read, from the (host order) NOFF header
+//	"image" is the in-memory image being filled in
+//----------------------------------------------------------------------
+
+static void
+ReadSegment(OpenFile *executable, Segment *seg, ExecImage *image)
+{
+    if (seg->size > 0) {
+	DEBUG(dbgAddr, seg->virtualAddr << ", " << seg->size);
+	executable->ReadAt(&(image->data[seg->virtualAddr]), seg->size,
+			   seg->inFileAddr);
+    }
+}
+
+//----------------------------------------------------------------------
+// SwapElfHeader, SwapProgramHeader
+// 	Convert the parts of the (little endian) ELF headers that we
+//	use into host byte order.
+//----------------------------------------------------------------------
+
+static void
+SwapElfHeader(ElfHeader *elfH)
+{
+    elfH->e_type = ShortToHost(elfH->e_type);
+    elfH->e_machine = ShortToHost(elfH->e_machine);
+    elfH->e_entry = WordToHost(elfH->e_entry);
+    elfH->e_phoff = WordToHost(elfH->e_phoff);
+    elfH->e_phentsize = ShortToHost(elfH->e_phentsize);
+    elfH->e_phnum = ShortToHost(elfH->e_phnum);
+}
+
+static void
+SwapProgramHeader(ElfProgramHeader *phdr)
+{
+    phdr->p_type = WordToHost(phdr->p_type);
+    phdr->p_offset = WordToHost(phdr->p_offset);
+    phdr->p_vaddr = WordToHost(phdr->p_vaddr);
+    phdr->p_filesz = WordToHost(phdr->p_filesz);
+    phdr->p_memsz = WordToHost(phdr->p_memsz);
+    phdr->p_flags = WordToHost(phdr->p_flags);
+}
+
+//----------------------------------------------------------------------
+// AddToSegment
+// 	Grow a NOFF segment so that it also covers "size" bytes at
+//	"virtualAddr".  An ELF file may have more than one loadable
+//	segment of a kind; any gap between them is left zero-filled.
+//----------------------------------------------------------------------
+
+static void
+AddToSegment(Segment *seg, int virtualAddr, int size)
+{
+    int end;
+
+    if (size <= 0) {
+	return;
+    }
+    if (seg->size == 0) {
+	seg->virtualAddr = virtualAddr;
+	seg->size = size;
+	return;
+    }
+    end = max(seg->virtualAddr + seg->size, virtualAddr + size);
+    seg->virtualAddr = min(seg->virtualAddr, virtualAddr);
+    seg->size = end - seg->virtualAddr;
+}
+
+//----------------------------------------------------------------------
+// ReadElf
+// 	Read a 32-bit little endian MIPS ELF executable into kernel
+//	memory.  The loadable segments are described by a made-up
+//	NOFF header -- executable segments as code, writable ones
+//	as initialized data, the rest as read-only data, and the
+//	zero-filled tail of each segment (bss) as uninitialized data --
+//	so the rest of the loader doesn't care that the file was ELF.
 //
-//	Assumes that the page table has been initialized, and that
-//	the object code file is in NOFF format.
+//	Returns NULL if the file isn't an executable we can run.
 //
-//	"fileName" is the file containing the object code to load into memory
+//	"executable" is the open executable file
+//	"fileName" is its name, and "stamp" when it was last modified
 //----------------------------------------------------------------------
 
-bool 
-AddrSpace::Load(char *fileName) 
+static ExecImage *
+ReadElf(OpenFile *executable, char *fileName, FileStamp *stamp)
+{
+    ElfHeader elfH;
+    ElfProgramHeader *phdrs, *ph;
+    NoffHeader noffH;
+    ExecImage *image;
+    int i;
+
+    executable->ReadAt((char *)&elfH, sizeof(elfH), 0);
+    SwapElfHeader(&elfH);
+    if ((elfH.e_ident[EI_CLASS] != ELFCLASS32) ||
+		(elfH.e_ident[EI_DATA] != ELFDATA2LSB) ||
+		(elfH.e_type != ET_EXEC) || (elfH.e_machine != EM_MIPS) ||
+		(elfH.e_phentsize != sizeof(ElfProgramHeader))) {
+	cerr << "File " << fileName << " is not a MIPS ELF executable\n";
+	return NULL;
+    }
+
+    phdrs = new ElfProgramHeader[elfH.e_phnum];
+    executable->ReadAt((char *)phdrs, elfH.e_phnum * sizeof(ElfProgramHeader),
+			elfH.e_phoff);
+
+    bzero((char *)&noffH, sizeof(noffH));
+    noffH.noffMagic = NOFFMAGIC;
+    for (i = 0; i < elfH.e_phnum; i++) {
+	ph = &phdrs[i];
+	SwapProgramHeader(ph);
+	if (ph->p_type != PT_LOAD) {
+	    continue;
+	}
+	if ((ph->p_filesz > ph->p_memsz) ||
+		(ph->p_vaddr >= (unsigned int) MemorySize) ||
+		(ph->p_memsz > MemorySize - ph->p_vaddr)) {
+	    cerr << "File " << fileName << " has a segment that won't fit "
+		 << "in memory\n";
+	    delete [] phdrs;
+	    return NULL;
+	}
+	if (ph->p_flags & PF_X) {
+	    AddToSegment(&noffH.code, ph->p_vaddr, ph->p_filesz);
+	} else if (ph->p_flags & PF_W) {
+	    AddToSegment(&noffH.initData, ph->p_vaddr, ph->p_filesz);
+	} else {
+#ifdef RDATA
+	    AddToSegment(&noffH.readonlyData, ph->p_vaddr, ph->p_filesz);
+#else
+	    AddToSegment(&noffH.initData, ph->p_vaddr, ph->p_filesz);
+#endif
+	}
+	AddToSegment(&noffH.uninitData, ph->p_vaddr + ph->p_filesz,
+			ph->p_memsz - ph->p_filesz);
+    }
+
+    image = new ExecImage(fileName, stamp, &noffH);
+    image->entryPoint = elfH.e_entry;
+    for (i = 0; i < elfH.e_phnum; i++) {
+	ph = &phdrs[i];
+	if ((ph->p_type == PT_LOAD) && (ph->p_filesz > 0)) {
+	    DEBUG(dbgAddr, "Initializing ELF segment: " << ph->p_vaddr 
+				<< ", " << ph->p_filesz);
+	    executable->ReadAt(&(image->data[ph->p_vaddr]), ph->p_filesz,
+				ph->p_offset);
+	}
+    }
+    delete [] phdrs;
+    return image;
+}
+
+//----------------------------------------------------------------------
+// CheckPagedSegment
+// 	Make sure that a segment of a page-aligned NOFF file (see
+//	coff2noff -p) is where the layout says it is, before the whole
+//	image is read in at once: at file offset virtualAddr +
+//	NOFFPAGESIZE, so that each page of the file lines up with a page
+//	of the address space, and inside both the address space and the
+//	file.  (ReadElf checks PT_LOAD segments the same way.)
+//
+//	"seg" is the segment, from the NOFF header
+//	"fileLength" is the size of the executable file
+//----------------------------------------------------------------------
+
+static bool
+CheckPagedSegment(Segment *seg, int fileLength)
 {
+    if (seg->size == 0) {
+	return TRUE;			// nothing to read
+    }
+    return ((seg->size > 0) && (seg->virtualAddr >= 0) &&
+		(seg->virtualAddr <= MemorySize - seg->size) &&
+		(seg->inFileAddr == seg->virtualAddr + NOFFPAGESIZE) &&
+		(seg->inFileAddr <= fileLength - seg->size));
+}
 
-    //cout << "in AddrSpace::Load , filename = " << fileName << endl;
+//----------------------------------------------------------------------
+// ReadExecutable
+// 	Read a user program from a file into kernel memory: parse
+//	the NOFF header, and read in the code and data segments.
+//
+//	ELF executables are recognized by their magic number, and
+//	handed off to ReadElf.
+//
+//	A page-aligned NOFF file (see coff2noff -p) is laid out the
+//	same way as the image, so it is read in all at once; otherwise
+//	each segment is read separately.
+//
+//	Returns NULL if the file can't be opened, or isn't a
+//	NOFF or ELF file, or is a page-aligned NOFF file whose segments
+//	aren't laid out that way.
+//
+//	"fileName" is the file containing the object code
+//----------------------------------------------------------------------
 
+static ExecImage *
+ReadExecutable(char *fileName)
+{
+    FileStamp stamp;
     OpenFile *executable = kernel->fileSystem->Open(fileName);
     NoffHeader noffH;
-    unsigned int size;
+    unsigned char *ident;
+    ExecImage *image;
+    int length;
 
     if (executable == NULL) {
-	    cerr << "Unable to open file " << fileName << "\n";
-	    return FALSE;
+	cerr << "Unable to open file " << fileName << "\n";
+	return NULL;
     }
+    GetFileStamp(fileName, &stamp);	// before reading, so that a
+					// concurrent change is noticed
 
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) && (WordToHost(noffH.noffMagic) == NOFFMAGIC)){
+    ident = (unsigned char *)&noffH;
+    if ((ident[0] == ELFMAG0) && (ident[1] == ELFMAG1) &&
+		(ident[2] == ELFMAG2) && (ident[3] == ELFMAG3)) {
+	image = ReadElf(executable, fileName, &stamp);
+	delete executable;		// close file
+	return image;
+    }
+    if ((noffH.noffMagic != NOFFMAGIC) && (noffH.noffMagic != NOFFPAGEDMAGIC)
+		&& ((WordToHost(noffH.noffMagic) == NOFFMAGIC) ||
+		    (WordToHost(noffH.noffMagic) == NOFFPAGEDMAGIC))) {
     	SwapHeader(&noffH);
     }
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    if ((noffH.noffMagic != NOFFMAGIC) && (noffH.noffMagic != NOFFPAGEDMAGIC)) {
+	cerr << "File " << fileName << " is not a NOFF executable\n";
+	delete executable;
+	return NULL;
+    }
+
+    if (noffH.noffMagic == NOFFPAGEDMAGIC) {
+	length = executable->Length();
+	if (!CheckPagedSegment(&noffH.code, length) ||
+		!CheckPagedSegment(&noffH.initData, length)
+#ifdef RDATA
+		|| !CheckPagedSegment(&noffH.readonlyData, length)
+#endif
+		) {
+	    cerr << "File " << fileName << " is not laid out as a "
+		 << "page-aligned image\n";
+	    delete executable;
+	    return NULL;
+	}
+    }
+
+    image = new ExecImage(fileName, &stamp, &noffH);
+
+    if (noffH.noffMagic == NOFFPAGEDMAGIC) {
+	// the file is already an image of the address space, one page
+	// after the header -- pull in every segment with a single read
+	DEBUG(dbgAddr, "Initializing page-aligned image.");
+	executable->ReadAt(image->data, image->dataSize, NOFFPAGESIZE);
+    } else {
+	DEBUG(dbgAddr, "Initializing code segment.");
+	ReadSegment(executable, &noffH.code, image);
+	DEBUG(dbgAddr, "Initializing data segment.");
+	ReadSegment(executable, &noffH.initData, image);
+#ifdef RDATA
+	DEBUG(dbgAddr, "Initializing read only data segment.");
+	ReadSegment(executable, &noffH.readonlyData, image);
+#endif
+    }
+
+    delete executable;			// close file
+    return image;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Load
+// 	Load a user program into memory from a file.
+//
+//	The parsed program comes from the kernel's executable cache
+//	if we have started it before (and it hasn't changed since);
+//	otherwise, we read it from the file and remember it.
+//
+//	The object code file may be in NOFF or (MIPS) ELF format.
+//
+//	"fileName" is the file containing the object code to load into memory
+//----------------------------------------------------------------------
+
+bool 
+AddrSpace::Load(char *fileName) 
+{
+    ExecImage *image;
+    bool cached;
+    unsigned int size;
+    int end;
+
+#ifdef FILESYS_STUB
+    image = kernel->execCache->Lookup(fileName);
+#else
+    image = NULL;		// no modification times on the Nachos disk,
+				// so we can't tell if a cached copy is stale
+#endif
+    cached = (image != NULL);
+    if (!cached) {
+	image = ReadExecutable(fileName);
+	if (image == NULL) {
+	    return FALSE;
+	}
+#ifdef FILESYS_STUB
+	kernel->execCache->Insert(image);
+	cached = TRUE;
+#endif
+    }
 
 #ifdef RDATA
 // how big is address space?
-    size = noffH.code.size + noffH.readonlyData.size + noffH.initData.size +
-           noffH.uninitData.size + UserStackSize;	
+    size = image->noffH.code.size + image->noffH.readonlyData.size + 
+	   image->noffH.initData.size + image->noffH.uninitData.size + 
+	   UserStackSize;	
                     // we need to increase the size to leave room for the stack
 #else
 // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
-			+ UserStackSize;	
+    size = image->noffH.code.size + image->noffH.initData.size + 
+	   image->noffH.uninitData.size + UserStackSize;	
             // we need to increase the size to leave room for the stack
 #endif
 
+    // the segments need not be packed together from address zero
+    // (an ELF file may leave gaps), so make sure we reach past the last
+    end = image->noffH.uninitData.virtualAddr + image->noffH.uninitData.size;
+    size = max(size, (unsigned int) (max(end, image->dataSize) + UserStackSize));
+    entryPoint = image->entryPoint;
+
     numPages = divRoundUp(size, PageSize); //calculate the page number
-    // size = numPages * PageSize;
 
+    DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
 
-    /***************************  11_1  *******************************/
+    if (numPages > (unsigned int) kernel->usedPhyPage->numUnused()) {
+	cerr << "Not enough free memory to run " << fileName << "\n";
+	numPages = 0;
+	if (!cached) {
+	    delete image;
+	}
+	return FALSE;
+    }
 
+    // 調整 physical number 的設定，使 page number != frame number
     pageTable = new TranslationEntry[numPages];
     for(int i=0;i<numPages;i++){
         pageTable[i].virtualPage = i;
-        // cout << "virtual page = " << pageTable[i].virtualPage << endl;
-        // 調整 physical number 的設定，使 page number != frame number
         pageTable[i].physicalPage = kernel->usedPhyPage->setPhyAddr();
-        // cout << "physical page = " << pageTable[i].physicalPage << endl;
-        // cout << endl;
         pageTable[i].valid = true;
         pageTable[i].use = false;
         pageTable[i].dirty = false;
         pageTable[i].readOnly = false;
 
         ASSERT(pageTable[i].physicalPage != -1); 
-        bzero(kernel->machine->mainMemory + pageTable[i].physicalPage * 
-              PageSize, PageSize);
     }
 
-    /***************************  11_1  *******************************/
+// then, copy in the code and data segments into memory, one page
+// at a time; everything past the end of the image (uninitialized
+// data and the stack) is zero-filled
 
-    // cout << "page information = " << endl;
-    // cout << "\tvirtual address = " << noffH.code.virtualAddr << endl;
-    // cout << "\tpage number = " << noffH.code.virtualAddr/PageSize << endl;
-    // cout << "\tframe number = " << pageTable[noffH.code.virtualAddr/PageSize].physicalPage << endl;
-    // cout << "\toffset = " << noffH.code.virtualAddr%PageSize << endl;
-    // cout << "\tphysical address = " << pageTable[noffH.code.virtualAddr/PageSize].physicalPage * PageSize + noffH.code.virtualAddr%PageSize << endl;
-
-
-    // ASSERT(numPages <= NumPhysPages);		// check we're not trying
-						// to run anything too big --
-						// at least until we have
-						// virtual memory
-
-    DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
-
-// then, copy in the code and data segments into memory
-
-    /***************************  11_1  *******************************/
-    unsigned int physicalAddr;
-
-    int unReadSize;
-    int chunkStart;
-    int chunkSize;
-    int inFilePosiotion;
-    /***************************  11_1  *******************************/
-
-
-    if (noffH.code.size > 0) {    
-        DEBUG(dbgAddr, "Initializing code segment.");
-	    DEBUG(dbgAddr, noffH.code.virtualAddr << ", " << noffH.code.size);
-
-
-        /***************************  11_1  *******************************/
-        unReadSize = noffH.code.size;
-        chunkStart = noffH.code.virtualAddr;
-        chunkSize = 0;
-        inFilePosiotion = 0;
-
-        /* while still unread code */
-        while(unReadSize > 0) {
-            
-            /* first chunk and last chunk might not be full */
-            chunkSize =  calChunkSize(chunkStart, unReadSize); 
-            Translate(chunkStart, &physicalAddr, 1);
-            executable->ReadAt(&(kernel->machine->mainMemory[physicalAddr]), chunkSize, noffH.code.inFileAddr + inFilePosiotion);
-
-            unReadSize = unReadSize - chunkSize;
-            chunkStart = chunkStart + chunkSize;
-            inFilePosiotion = inFilePosiotion + chunkSize;
-        }
-        /***************************  11_1  *******************************/
-    }
-
-
-    if (noffH.initData.size > 0) {
-        DEBUG(dbgAddr, "Initializing data segment.");
-	    DEBUG(dbgAddr, noffH.initData.virtualAddr << ", " << noffH.initData.size);
-
-        /***************************  11_1  *******************************/
-        unReadSize = noffH.initData.size;
-        chunkStart = noffH.initData.virtualAddr;
-        chunkSize = 0;
-        inFilePosiotion = 0;
-
-        /* while still unread code */
-        while(unReadSize > 0) {
-            /* first chunk and last chunk might not be full */
-            chunkSize =  calChunkSize(chunkStart, unReadSize); 
-            Translate(chunkStart, &physicalAddr, 1);
-            executable->ReadAt(&(kernel->machine->mainMemory[physicalAddr]), chunkSize, noffH.initData.inFileAddr + inFilePosiotion);
-
-            unReadSize = unReadSize - chunkSize;
-            chunkStart = chunkStart + chunkSize;
-            inFilePosiotion = inFilePosiotion + chunkSize;
+    for(int i=0;i<numPages;i++){
+        char *frame = kernel->machine->mainMemory + 
+			pageTable[i].physicalPage * PageSize;
+        int inImage = image->dataSize - i * PageSize;
+
+        if (inImage <= 0) {
+            bzero(frame, PageSize);
+        } else if (inImage < PageSize) {
+            bcopy(image->data + i * PageSize, frame, inImage);
+            bzero(frame + inImage, PageSize - inImage);
+        } else {
+            bcopy(image->data + i * PageSize, frame, PageSize);
         }
-        /***************************  11_1  *******************************/
     }
 
-#ifdef RDATA
-    if (noffH.readonlyData.size > 0) {
-        DEBUG(dbgAddr, "Initializing read only data segment.");
-	    DEBUG(dbgAddr, noffH.readonlyData.virtualAddr << ", " << noffH.readonlyData.size);
-
-        /***************************  11_1  *******************************/
-        unReadSize = noffH.readonlyData.size;
-        chunkStart = noffH.readonlyData.virtualAddr;
-        chunkSize = 0;
-        inFilePosiotion = 0;
-
-        /* while still unread code */
-        while(unReadSize > 0) {
-            /* first chunk and last chunk might not be full */
-            chunkSize =  calChunkSize(chunkStart, unReadSize); 
-            Translate(chunkStart, &physicalAddr, 1);
-            executable->ReadAt(&(kernel->machine->mainMemory[physicalAddr]), chunkSize, noffH.readonlyData.inFileAddr + inFilePosiotion);
-
-            unReadSize = unReadSize - chunkSize;
-            chunkStart = chunkStart + chunkSize;
-            inFilePosiotion = inFilePosiotion + chunkSize;
-        }
-        /***************************  11_1  *******************************/
+    if (!cached) {
+	delete image;
     }
-
-#endif
-
-
-    delete executable;			// close file
     return TRUE;			    // success
 }
 
@@ -278,8 +542,10 @@ AddrSpace::Execute(char* fileName)
 
     kernel->currentThread->space = this;
 
+    kernel->currentThread->ClaimUserState();	// the registers are ours
     this->InitRegisters();		// set the initial register values
     this->RestoreState();		// load page table register
+    this->PushArguments();		// pass argc, argv to main()
 
     kernel->machine->Run();		// jump to the user progam
 
@@ -309,14 +575,15 @@ AddrSpace::InitRegisters()
 	machine->WriteRegister(i, 0);
 
     // Initial program counter -- must be location of "Start", which
-    //  is assumed to be virtual address zero
-    machine->WriteRegister(PCReg, 0);	
+    //  is virtual address zero for NOFF files, and the ELF entry
+    //  point otherwise
+    machine->WriteRegister(PCReg, entryPoint);	
 
     // Need to also tell MIPS where next instruction is, because
     // of branch delay possibility
     // Since instructions occupy four bytes each, the next instruction
-    // after start will be at virtual address four.
-    machine->WriteRegister(NextPCReg, 4);
+    // after start will be four bytes later.
+    machine->WriteRegister(NextPCReg, entryPoint + 4);
 
    // Set the stack register to the end of the address space, where we
    // allocated the stack; but subtract off a bit, to make sure we don't
@@ -325,6 +592,54 @@ AddrSpace::InitRegisters()
     DEBUG(dbgAddr, "Initializing stack pointer: " << numPages * PageSize - 16);
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::PushArguments
+// 	Copy the program's arguments onto the top of its user stack,
+//	and pass them to it as main(argc, argv): r4 holds the number
+//	of arguments, and r5 the address of the (null-terminated)
+//	argv[] array.
+//
+//	Must be called after InitRegisters and RestoreState, since the
+//	arguments are written through the machine's page table.  The
+//	writes can't fail: the stack pages are always mapped, and
+//	SetArguments made sure the arguments fit.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PushArguments()
+{
+    Machine *machine = kernel->machine;
+    int sp = machine->ReadRegister(StackReg);
+    int *argAddr;
+    int len, i, j;
+
+    if (numArgs == 0) {
+	return;
+    }
+    argAddr = new int[numArgs];
+    for (i = 0; i < numArgs; i++) {	// first, the strings themselves
+	len = strlen(args[i]) + 1;
+	sp -= len;
+	for (j = 0; j < len; j++) {
+	    (void) machine->WriteMem(sp + j, 1, args[i][j]);
+	}
+	argAddr[i] = sp;
+    }
+    sp &= ~3;				// then the word-aligned argv[]
+    sp -= (numArgs + 1) * sizeof(int);
+    for (i = 0; i < numArgs; i++) {
+	(void) machine->WriteMem(sp + i * sizeof(int), 4, argAddr[i]);
+    }
+    (void) machine->WriteMem(sp + numArgs * sizeof(int), 4, 0);
+    delete [] argAddr;
+
+    machine->WriteRegister(4, numArgs);
+    machine->WriteRegister(5, sp);
+    machine->WriteRegister(StackReg, sp - 16);	// room for main() to save
+						// its arguments
+    DEBUG(dbgAddr, "Passing " << numArgs << " arguments at " << sp);
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::SaveState
 // 	On a context switch, save any machine state, specific
@@ -341,15 +656,292 @@ void AddrSpace::SaveState()
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table --
+//	unless it still has ours, because no other program has run
+//	since we were switched out.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
+    if (kernel->machine->pageTableOwner == this) {
+	return;				// still loaded
+    }
     kernel->machine->pageTable = pageTable;
     kernel->machine->pageTableSize = numPages;
+    kernel->machine->pageTableOwner = this;
+}
+
+
+//----------------------------------------------------------------------
+// UserThread::UserThread
+// 	Initialize the entry for a thread that has just been started
+//	in an address space.
+//
+//	"threadID" is the thread's ID within its program
+//	"t" is the thread
+//	"stack" is the top of its user stack (0 for the first thread)
+//----------------------------------------------------------------------
+
+UserThread::UserThread(int threadID, Thread *t, int stack)
+{
+    id = threadID;
+    thread = t;
+    stackTop = stack;
+    exitStatus = 0;
+    numJoiners = 0;
+    exited = new Semaphore("thread exited", 0);
 }
 
+UserThread::~UserThread()
+{
+    delete exited;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddThread
+// 	Record that a thread runs in this address space.  The first
+//	thread gets ID 0, and each one forked after that the next ID.
+//
+//	Returns the thread's ID, for ThreadJoin.
+//
+//	"thread" is the thread
+//	"stackTop" is the top of its user stack (0 for the first
+//		thread, which uses the stack Load set up)
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AddThread(Thread *thread, int stackTop)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    UserThread *entry = new UserThread(nextThreadID++, thread, stackTop);
+
+    threads->Append(entry);
+    numRunning++;
+    numRefs++;
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    return entry->id;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindThread
+// 	Return the entry for the thread with ID "threadID", or NULL if
+//	there is none (or it has been joined already).
+//----------------------------------------------------------------------
+
+UserThread *
+AddrSpace::FindThread(int threadID)
+{
+    ListIterator<UserThread *> iter(threads);
+
+    for (; !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->id == threadID) {
+	    return iter.Item();
+	}
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RemoveThread
+// 	A thread running in this address space has exited: wake up the
+//	threads waiting to join it, and keep its user stack for the
+//	next thread to be forked.  If no one is waiting yet, its entry
+//	stays around for a later ThreadJoin.
+//
+//	Returns TRUE if that was the last thread, so that the program
+//	has exited.
+//
+//	"thread" is the thread that exited
+//	"status" is the status it passed to ThreadExit (or Exit)
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::RemoveThread(Thread *thread, int status)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    ListIterator<UserThread *> iter(threads);
+    UserThread *entry = NULL;
+    bool last;
+
+    for (; !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->thread == thread) {
+	    entry = iter.Item();
+	}
+    }
+    if (entry != NULL) {
+	DEBUG(dbgAddr, "Thread " << entry->id << " of " << getName()
+		<< " exits with status " << status);
+	entry->thread = NULL;
+	entry->exitStatus = status;
+	if (entry->stackTop != 0) {	// we are done with the user stack
+	    freeStacks->Append(entry->stackTop);
+	}
+	for (int i = 0; i < entry->numJoiners; i++) {
+	    entry->exited->V();
+	}
+    }
+    last = (--numRunning == 0);
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    return last;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::JoinThread
+// 	Wait for a thread in this address space to exit, and return the
+//	status it passed to ThreadExit.  Every thread that is waiting
+//	when it exits gets the status; after that, the first thread to
+//	join it (if none was waiting) gets it, and the entry goes away.
+//
+//	Returns -1 if there is no such thread, or it is the caller.
+//
+//	"threadID" is the ID of the thread to wait for
+//----------------------------------------------------------------------
+
+int
+AddrSpace::JoinThread(int threadID)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    UserThread *entry = FindThread(threadID);
+    int status;
+
+    if (entry == NULL || entry->thread == kernel->currentThread) {
+	(void) kernel->interrupt->SetLevel(oldLevel);
+	return -1;
+    }
+    if (entry->thread != NULL) {	// still running
+	entry->numJoiners++;
+	entry->exited->P();
+	entry->numJoiners--;
+    }
+    status = entry->exitStatus;
+    if (entry->numJoiners == 0) {	// everyone has the status
+	threads->Remove(entry);
+	delete entry;
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    return status;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Detach
+// 	A thread that ran in this address space is being recycled (see
+//	ThreadPool::Put).  Returns TRUE if no thread refers to the
+//	address space any more, so that it can be deleted.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::Detach()
+{
+    ASSERT(numRefs > 0);
+    return (--numRefs == 0);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateStack
+// 	Return the top of a user stack for a new thread: the stack of a
+//	thread that has exited, or else UserStackSize bytes of new,
+//	zero-filled pages added to the top of the address space.
+//
+//	Returns 0 if there isn't enough physical memory.
+//
+//	The page table is replaced by a bigger one, so the caller must
+//	be running in this address space.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AllocateStack()
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    int numNew = divRoundUp(UserStackSize, PageSize);
+    TranslationEntry *newTable;
+    int stackTop = 0;
+
+    if (!freeStacks->IsEmpty()) {
+	stackTop = freeStacks->RemoveFront();
+	(void) kernel->interrupt->SetLevel(oldLevel);
+	return stackTop;
+    }
+    if (numNew > kernel->usedPhyPage->numUnused()) {
+	(void) kernel->interrupt->SetLevel(oldLevel);
+	return 0;
+    }
+    newTable = new TranslationEntry[numPages + numNew];
+    for (unsigned int i = 0; i < numPages; i++) {
+	newTable[i] = pageTable[i];
+    }
+    for (unsigned int i = numPages; i < numPages + numNew; i++) {
+        newTable[i].virtualPage = i;
+        newTable[i].physicalPage = kernel->usedPhyPage->setPhyAddr();
+        newTable[i].valid = true;
+        newTable[i].use = false;
+        newTable[i].dirty = false;
+        newTable[i].readOnly = false;
+        bzero(kernel->machine->mainMemory
+		+ newTable[i].physicalPage * PageSize, PageSize);
+    }
+    kernel->machine->Forget(this);	// no CPU may keep the old table
+    delete [] pageTable;
+    pageTable = newTable;
+    numPages += numNew;
+    RestoreState();
+    stackTop = numPages * PageSize;
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    DEBUG(dbgAddr, "Adding user stack: " << numPages << " pages");
+    return stackTop;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::StartThread
+// 	Run a thread forked in this address space: start it in user mode
+//	at "func", on its own user stack.  "func" is called as a MIPS
+//	procedure, so if it returns it jumps to "retAddr", which is
+//	expected to call ThreadExit.
+//
+//	"func" is the virtual address of the function the thread runs
+//	"stackTop" is the top of its user stack
+//	"retAddr" is the virtual address "func" returns to
+//----------------------------------------------------------------------
+
+void
+AddrSpace::StartThread(int func, int stackTop, int retAddr)
+{
+    Machine *machine = kernel->machine;
+
+    kernel->currentThread->ClaimUserState();	// the registers are ours
+    for (int i = 0; i < NumTotalRegs; i++)
+	machine->WriteRegister(i, 0);
+    machine->WriteRegister(PCReg, func);
+    machine->WriteRegister(NextPCReg, func + 4);
+    machine->WriteRegister(StackReg, stackTop - 16);
+    machine->WriteRegister(RetAddrReg, retAddr);
+    this->RestoreState();		// load page table register
+
+    machine->Run();			// jump to the user code
+
+    ASSERTNOTREACHED();			// the thread ends with ThreadExit
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsReadable
+// 	Check that a system call argument can be read out of this address
+//	space.  Machine::ReadMem can't be used to find out: on a bad
+//	address it raises an exception, as if the user program itself
+//	had made the access, rather than returning FALSE.
+//
+//	"vaddr" is the virtual address to be read
+//	"size" is the number of bytes to read (1, 2, or 4)
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsReadable(int vaddr, int size)
+{
+    unsigned int paddr;
+
+    if (vaddr < 0 || (vaddr % size) != 0) {	// an aligned read can't
+	return FALSE;				// straddle two pages
+    }
+    return (Translate((unsigned int) vaddr, &paddr, 0) == NoException);
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::Translate
@@ -400,15 +992,3 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
 
     return NoException;
 }
-
-int AddrSpace::calChunkSize(int chunkStart, int unReadSize)
-{
-    int chunkSize;
-    chunkSize = (chunkStart / PageSize + 1) * PageSize - chunkStart;
-    if(chunkSize > unReadSize) chunkSize = unReadSize; 
-    return chunkSize;
-}
-
-
-
-
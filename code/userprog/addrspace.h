@@ -6,6 +6,15 @@
 //	The user level CPU state is saved and restored in the thread
 //	executing the user program (see thread.h).
 //
+//	A program may run several threads (see ThreadFork), all of
+//	which share its address space.  Each has its own user stack:
+//	the first thread's is at the top of the space Load sets up, and
+//	each thread forked after that gets UserStackSize more bytes
+//	above the rest (or the stack of a thread that has exited).  The
+//	address space keeps track of its threads, so that they can wait
+//	for each other (ThreadJoin); the program has exited once all of
+//	them have.
+//
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -15,9 +24,33 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "list.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
 
+class Thread;
+class Semaphore;
+
+// The following class defines one of the threads running in an
+// address space, as far as ThreadJoin is concerned.  It outlives the
+// thread itself, until the threads joining it have its exit status.
+
+class UserThread {
+  public:
+    UserThread(int threadID, Thread *t, int stack);
+				// initialize the entry of a new thread
+    ~UserThread();		// de-allocate the entry
+
+    int id;			// the thread's ID within the program
+    Thread *thread;		// the thread; NULL once it has exited
+    int stackTop;		// top of its user stack; 0 for the
+				// program's first thread
+    int exitStatus;		// what it passed to ThreadExit
+    int numJoiners;		// # of threads that still have to get
+				// "exitStatus"
+    Semaphore *exited;		// joiners wait here for it to exit
+};
+
 class AddrSpace {
   public:
     AddrSpace();			// Create an address space.
@@ -31,27 +64,78 @@ class AddrSpace {
 					// assumes the program has already
                                         // been loaded
 
+    bool SetArguments(int argc, char **argv);
+					// Keep a copy of the arguments to
+					// pass to main(); argv[0] is the
+					// program name.  Return false if
+					// they won't fit on the stack
+    char *getName() { return (numArgs > 0 ? args[0] : NULL); }
+
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
 
+    int AddThread(Thread *thread, int stackTop);
+					// "thread" runs in this space, on
+					// the user stack below "stackTop"
+					// (0 for the first thread's);
+					// returns its ID
+    bool RemoveThread(Thread *thread, int status);
+					// "thread" has exited with "status";
+					// TRUE if it was the last one
+    int JoinThread(int threadID);	// wait for a thread to exit, and
+					// return its status, or -1
+    bool Detach();			// a thread no longer refers to us;
+					// TRUE if we can be deleted
+    int AllocateStack();		// return the top of a fresh user
+					// stack, or 0 if out of memory
+    void StartThread(int func, int stackTop, int retAddr);
+					// run a forked thread: call "func"
+					// on the stack below "stackTop",
+					// returning to "retAddr"
+    void setExitStatus(int status) { exitStatus = status; }
+    int getExitStatus() { return exitStatus; }
+
     // Translate virtual address _vaddr_
     // to physical address _paddr_. _mode_
     // is 0 for Read, 1 for Write.
     ExceptionType Translate(unsigned int vaddr, unsigned int *paddr, int mode);
 
-    /********************************************************/
-    int calChunkSize(int chunkStart, int unReadSize);
-    /********************************************************/
-   
+    bool IsReadable(int vaddr, int size);
+					// can the kernel read "size" (1, 2
+					// or 4) bytes at "vaddr"?  Unlike
+					// Machine::ReadMem, a bad address
+					// doesn't raise an exception
+
 
   private:
     TranslationEntry *pageTable;	
         // Assume linear page table translation for now!
     unsigned int numPages;		
         // Number of pages in the virtual address space
+    int entryPoint;
+        // Virtual address of the first user instruction
+
+    int numArgs;
+    char **args;
+        // Arguments to main(), in kernel memory
+
+    List<UserThread *> *threads;	// threads that are running, or
+					// that someone may still join
+    int nextThreadID;			// ID for the next thread forked
+    int numRunning;			// # of threads that haven't exited
+    int numRefs;			// # of Thread objects that still
+					// point to us
+    List<int> *freeStacks;		// tops of user stacks of threads
+					// that have exited
+    int exitStatus;			// what the program passed to Exit
+
+    UserThread *FindThread(int threadID);
+					// the entry for a thread, or NULL
 
     void InitRegisters();		
     // Initialize user-level CPU registers , before jumping to user code
+    void PushArguments();
+    // Copy the arguments onto the user stack, and point r4/r5 at them
 
 };
 
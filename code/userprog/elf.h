@@ -0,0 +1,69 @@
+/* elf.h
+ *     Data structures defining the parts of the ELF object file
+ *     format that Nachos understands.
+ *
+ *     We only load 32-bit, little-endian, statically linked MIPS
+ *     executables; of those, we only look at the file header and
+ *     the loadable (PT_LOAD) entries of the program header table.
+ *     Everything else (sections, symbols, relocation) is ignored.
+ */
+
+#ifndef ELF_H
+#define ELF_H
+
+#define ELFMAG0		0x7f		/* e_ident[0..3] of every ELF file */
+#define ELFMAG1		'E'
+#define ELFMAG2		'L'
+#define ELFMAG3		'F'
+
+#define EI_CLASS	4		/* index of the file class */
+#define EI_DATA		5		/* index of the data encoding */
+#define EI_NIDENT	16		/* size of e_ident[] */
+
+#define ELFCLASS32	1		/* 32-bit objects */
+#define ELFDATA2LSB	1		/* little-endian */
+
+#define ET_EXEC		2		/* executable file */
+#define EM_MIPS		8		/* MIPS R3000 */
+
+#define PT_LOAD		1		/* loadable segment */
+
+#define PF_X		0x1		/* segment is executable */
+#define PF_W		0x2		/* segment is writable */
+#define PF_R		0x4		/* segment is readable */
+
+typedef struct elfHeader {
+   unsigned char e_ident[EI_NIDENT];	/* magic number, class, encoding */
+   unsigned short e_type;		/* should be ET_EXEC */
+   unsigned short e_machine;		/* should be EM_MIPS */
+   unsigned int e_version;
+   unsigned int e_entry;		/* virtual address of first
+					 * instruction
+					 */
+   unsigned int e_phoff;		/* program header table file offset */
+   unsigned int e_shoff;
+   unsigned int e_flags;
+   unsigned short e_ehsize;
+   unsigned short e_phentsize;		/* size of one program header */
+   unsigned short e_phnum;		/* number of program headers */
+   unsigned short e_shentsize;
+   unsigned short e_shnum;
+   unsigned short e_shstrndx;
+} ElfHeader;
+
+typedef struct elfProgramHeader {
+   unsigned int p_type;			/* PT_LOAD, or something we skip */
+   unsigned int p_offset;		/* location of segment in this file */
+   unsigned int p_vaddr;		/* location of segment in virt
+					 * addr space
+					 */
+   unsigned int p_paddr;
+   unsigned int p_filesz;		/* bytes of the segment in the file */
+   unsigned int p_memsz;		/* bytes in memory -- anything past
+					 * p_filesz is zero'ed (bss)
+					 */
+   unsigned int p_flags;		/* PF_X, PF_W, PF_R */
+   unsigned int p_align;
+} ElfProgramHeader;
+
+#endif // ELF_H
@@ -25,6 +25,92 @@
 #include "main.h"
 #include "syscall.h"
 #include "ksyscall.h"
+
+// Longest file name, and most arguments, we accept from Exec and ExecV.
+static const int MaxUserString = 256;
+static const int MaxUserArgs = 16;
+
+//----------------------------------------------------------------------
+// CopyStringFromUser
+// 	Copy a null-terminated string out of the user's address space,
+//	through the page table (user strings needn't be contiguous in
+//	physical memory).
+//
+//	Returns a new kernel copy, which the caller must delete, or
+//	NULL if the string is too long or not in the address space.
+//	Addresses are checked before they are read, so a bad pointer
+//	fails the system call rather than the user program.
+//
+//	"vaddr" is the string's virtual address
+//----------------------------------------------------------------------
+
+static char *
+CopyStringFromUser(int vaddr)
+{
+    AddrSpace *space = kernel->currentThread->space;
+    char *str = new char[MaxUserString + 1];
+    int ch;
+
+    for (int i = 0; i <= MaxUserString; i++) {
+	if (!space->IsReadable(vaddr + i, 1) ||
+		!kernel->machine->ReadMem(vaddr + i, 1, &ch)) {
+	    break;
+	}
+	str[i] = (char) ch;
+	if (ch == '\0') {
+	    return str;
+	}
+    }
+    delete [] str;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// CopyArgsFromUser
+// 	Copy an argv[] array, and the strings it points to, out of the
+//	user's address space.
+//
+//	Returns a new kernel array, to be freed with FreeArgs, or NULL
+//	if any of the arguments can't be copied.
+//
+//	"argc" is the number of arguments
+//	"vaddr" is the virtual address of the argv[] array
+//----------------------------------------------------------------------
+
+static void
+FreeArgs(int argc, char **argv)
+{
+    for (int i = 0; i < argc; i++) {
+	delete [] argv[i];
+    }
+    delete [] argv;
+}
+
+static char **
+CopyArgsFromUser(int argc, int vaddr)
+{
+    AddrSpace *space = kernel->currentThread->space;
+    char **argv;
+    int ptr;
+
+    if (argc <= 0 || argc > MaxUserArgs) {
+	return NULL;
+    }
+    argv = new char *[argc];
+    for (int i = 0; i < argc; i++) {
+	argv[i] = NULL;
+    }
+    for (int i = 0; i < argc; i++) {
+	if (!space->IsReadable(vaddr + i * 4, 4) ||
+		!kernel->machine->ReadMem(vaddr + i * 4, 4, &ptr) ||
+		(argv[i] = CopyStringFromUser(ptr)) == NULL) {
+	    FreeArgs(argc, argv);
+	    return NULL;
+	}
+    }
+    return argv;
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -210,11 +296,164 @@ ExceptionHandler(ExceptionType which)
 			break;
 		}
 		
+		case SC_Exec:
+		{
+			DEBUG(dbgSys, "Exec\n");
+			val = kernel->machine->ReadRegister(4);
+			char *name = CopyStringFromUser(val);
+
+			if (name == NULL) {
+				status = -1;
+			} else {
+				status = SysExec(name);
+				delete [] name;		// the new address space has
+							// its own copy
+			}
+			kernel->machine->WriteRegister(2, (int) status);
+
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+			ASSERTNOTREACHED();
+			break;
+		}
+
+		case SC_ExecV:
+		{
+			DEBUG(dbgSys, "ExecV\n");
+			int argc = kernel->machine->ReadRegister(4);
+			char **argv = CopyArgsFromUser(argc, kernel->machine->ReadRegister(5));
+
+			if (argv == NULL) {
+				status = -1;
+			} else {
+				status = SysExecV(argc, argv);
+				FreeArgs(argc, argv);
+			}
+			kernel->machine->WriteRegister(2, (int) status);
+
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+			ASSERTNOTREACHED();
+			break;
+		}
+
+		case SC_Join:
+			DEBUG(dbgSys, "Join " << kernel->machine->ReadRegister(4) << "\n");
+			val = kernel->machine->ReadRegister(4);
+			status = SysJoin(val);
+			kernel->machine->WriteRegister(2, (int) status);
+
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+			ASSERTNOTREACHED();
+			break;
+
+		case SC_ThreadFork:
+			DEBUG(dbgSys, "ThreadFork " << kernel->machine->ReadRegister(4) << "\n");
+			val = kernel->machine->ReadRegister(4);
+			status = SysThreadFork(val, kernel->machine->ReadRegister(5));
+			kernel->machine->WriteRegister(2, (int) status);
+
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+			ASSERTNOTREACHED();
+			break;
+
+		case SC_ThreadYield:
+			DEBUG(dbgSys, "ThreadYield\n");
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			SysThreadYield();
+			return;
+			ASSERTNOTREACHED();
+			break;
+
+		case SC_ThreadJoin:
+			DEBUG(dbgSys, "ThreadJoin " << kernel->machine->ReadRegister(4) << "\n");
+			val = kernel->machine->ReadRegister(4);
+			status = SysThreadJoin(val);
+			kernel->machine->WriteRegister(2, (int) status);
+
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+			ASSERTNOTREACHED();
+			break;
+
+		case SC_ThreadExit:
+			DEBUG(dbgSys, "ThreadExit " << kernel->machine->ReadRegister(4) << "\n");
+			val = kernel->machine->ReadRegister(4);
+			SysThreadExit(val);
+			ASSERTNOTREACHED();
+			break;
+
+		case SC_SetTickets:
+			DEBUG(dbgSys, "SetTickets " << kernel->machine->ReadRegister(4) << "\n");
+			val = kernel->machine->ReadRegister(4);
+			status = SysSetTickets(val);
+			kernel->machine->WriteRegister(2, (int) status);
+
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+			ASSERTNOTREACHED();
+			break;
+
+		case SC_SetRealTime:
+			DEBUG(dbgSys, "SetRealTime " << kernel->machine->ReadRegister(4) << ", " << kernel->machine->ReadRegister(5) << "\n");
+			status = SysSetRealTime(kernel->machine->ReadRegister(4),
+						kernel->machine->ReadRegister(5));
+			kernel->machine->WriteRegister(2, (int) status);
+
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+			ASSERTNOTREACHED();
+			break;
+
+		case SC_FutexWait:
+			DEBUG(dbgSys, "FutexWait " << kernel->machine->ReadRegister(4) << ", " << kernel->machine->ReadRegister(5) << "\n");
+			status = SysFutexWait(kernel->machine->ReadRegister(4),
+						kernel->machine->ReadRegister(5));
+			kernel->machine->WriteRegister(2, (int) status);
+
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+			ASSERTNOTREACHED();
+			break;
+
+		case SC_FutexWake:
+			DEBUG(dbgSys, "FutexWake " << kernel->machine->ReadRegister(4) << ", " << kernel->machine->ReadRegister(5) << "\n");
+			status = SysFutexWake(kernel->machine->ReadRegister(4),
+						kernel->machine->ReadRegister(5));
+			kernel->machine->WriteRegister(2, (int) status);
+
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+			return;
+			ASSERTNOTREACHED();
+			break;
+
 		//////////////////////////////////////////	
 		case SC_Exit:
 			DEBUG(dbgAddr, "Program exit\n");
             val=kernel->machine->ReadRegister(4);
-			kernel->currentThread->Finish();
+			SysExit(val);
             break;
       	default:
 			cerr << "Unexpected system call " << type << "\n";
@@ -0,0 +1,166 @@
+// execcache.cc
+//	Routines to keep parsed user executables in kernel memory.
+//
+//	The cache is a short list, kept in most-recently-used order;
+//	we only expect a handful of different programs to be started
+//	over and over, so a linear search by name is good enough.
+//
+//	NOTE: we assume we are running on a uniprocessor, and that
+//	nothing in here is called from an interrupt handler, so no
+//	further synchronization is needed.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "execcache.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// ExecImage::ExecImage
+// 	Initialize an in-memory copy of an executable.  The segment
+//	bytes are zero-filled; the caller reads the file into "data".
+//
+//	"fileName" is the executable file the image comes from
+//	"fileStamp" is when that file was last modified, and its size
+//	"header" is the executable's header, in host byte order
+//----------------------------------------------------------------------
+
+ExecImage::ExecImage(char *fileName, FileStamp *fileStamp, NoffHeader *header)
+{
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    stamp = *fileStamp;
+    noffH = *header;
+    entryPoint = 0;
+
+    dataSize = 0;
+    if (noffH.code.size > 0) {
+	dataSize = max(dataSize, noffH.code.virtualAddr + noffH.code.size);
+    }
+    if (noffH.initData.size > 0) {
+	dataSize = max(dataSize,
+			noffH.initData.virtualAddr + noffH.initData.size);
+    }
+#ifdef RDATA
+    if (noffH.readonlyData.size > 0) {
+	dataSize = max(dataSize,
+		noffH.readonlyData.virtualAddr + noffH.readonlyData.size);
+    }
+#endif
+    data = new char[dataSize];
+    bzero(data, dataSize);
+}
+
+//----------------------------------------------------------------------
+// ExecImage::~ExecImage
+// 	De-allocate an in-memory copy of an executable.
+//----------------------------------------------------------------------
+
+ExecImage::~ExecImage()
+{
+    delete [] name;
+    delete [] data;
+}
+
+//----------------------------------------------------------------------
+// ExecCache::ExecCache
+// 	Initialize an empty cache of executables.
+//
+//	"maxImages" is the most executables we keep in memory at once
+//----------------------------------------------------------------------
+
+ExecCache::ExecCache(int maxImages)
+{
+    images = new List<ExecImage *>;
+    this->maxImages = maxImages;
+    numHits = numMisses = 0;
+}
+
+//----------------------------------------------------------------------
+// ExecCache::~ExecCache
+// 	De-allocate the cache, and every image in it.
+//----------------------------------------------------------------------
+
+ExecCache::~ExecCache()
+{
+    while (!images->IsEmpty()) {
+	delete images->RemoveFront();
+    }
+    delete images;
+}
+
+//----------------------------------------------------------------------
+// ExecCache::Lookup
+// 	Find the cached image of an executable.  An image is only
+//	good if the file has not been modified since we read it in;
+//	otherwise, the image is thrown away.
+//
+//	On a hit, the image moves to the front of the list, so that
+//	the least recently used image is always at the end.
+//
+//	Returns NULL if the caller must read the executable itself.
+//
+//	"fileName" is the executable to look for
+//----------------------------------------------------------------------
+
+ExecImage *
+ExecCache::Lookup(char *fileName)
+{
+    ListIterator<ExecImage *> iter(images);
+    ExecImage *image = NULL;
+    FileStamp stamp;
+
+    for (; !iter.IsDone(); iter.Next()) {
+	if (strcmp(iter.Item()->name, fileName) == 0) {
+	    image = iter.Item();
+	    break;
+	}
+    }
+    if (image == NULL) {
+	numMisses++;
+	return NULL;
+    }
+
+    images->Remove(image);
+    GetFileStamp(fileName, &stamp);
+    if (!image->stamp.Equals(&stamp)) {		// file has changed
+	DEBUG(dbgAddr, "Exec cache: dropping stale image of " << fileName);
+	delete image;
+	numMisses++;
+	return NULL;
+    }
+    images->Prepend(image);
+    numHits++;
+    DEBUG(dbgAddr, "Exec cache hit: " << fileName << " (" << numHits
+				<< " hits, " << numMisses << " misses)");
+    return image;
+}
+
+//----------------------------------------------------------------------
+// ExecCache::Insert
+// 	Add a freshly read executable image to the cache.  The cache
+//	now owns the image.  If the cache is full, the least recently
+//	used image is evicted.
+//
+//	"image" is the executable image to keep
+//----------------------------------------------------------------------
+
+void
+ExecCache::Insert(ExecImage *image)
+{
+    ExecImage *victim;
+
+    if (images->NumInList() >= (unsigned int) maxImages) {
+	victim = images->Front();	// find the last element
+	ListIterator<ExecImage *> iter(images);
+	for (; !iter.IsDone(); iter.Next()) {
+	    victim = iter.Item();
+	}
+	DEBUG(dbgAddr, "Exec cache: evicting " << victim->name);
+	images->Remove(victim);
+	delete victim;
+    }
+    images->Prepend(image);
+}
@@ -0,0 +1,72 @@
+// execcache.h
+//	Data structures for keeping parsed user executables in kernel
+//	memory, so that starting the same program again does not have
+//	to open the file and parse its header a second time.
+//
+//	An ExecImage holds the NOFF header of an executable (for an
+//	ELF executable, one made up from its program headers), plus
+//	the bytes of every segment that is backed by the file, laid out
+//	by virtual address -- so that loading a program is just a copy
+//	of one page at a time into physical memory.
+//
+//	Cached images are keyed by the file name and the time the
+//	file was last modified; a stale entry is thrown away the
+//	next time it is looked up.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef EXECCACHE_H
+#define EXECCACHE_H
+
+#include "copyright.h"
+#include "list.h"
+#include "noff.h"
+#include "sysdep.h"
+
+// Maximum number of executables kept in the cache at once.
+const int MaxCachedExecs = 16;
+
+// The following class defines the in-memory copy of an executable.
+
+class ExecImage {
+  public:
+    ExecImage(char *fileName, FileStamp *fileStamp, NoffHeader *header);
+					// initialize an empty image
+    ~ExecImage();			// de-allocate the image
+
+    char *name;			// executable file name (our own copy)
+    FileStamp stamp;		// file modification time and size,
+				// when read in
+    NoffHeader noffH;		// header, already in host byte order
+    char *data;			// initialized segment bytes, indexed
+				// by virtual address
+    int dataSize;		// bytes in "data" -- the end of the
+				// last segment backed by the file
+    int entryPoint;		// virtual address of the first
+				// instruction (zero for NOFF files)
+};
+
+// The following class defines the cache of executables.
+
+class ExecCache {
+  public:
+    ExecCache(int maxImages);	// initialize an empty cache
+    ~ExecCache();		// de-allocate all cached images
+
+    ExecImage *Lookup(char *fileName);
+				// return the image for "fileName", or
+				// NULL if it isn't cached or is stale
+    void Insert(ExecImage *image);
+				// add an image, evicting the least
+				// recently used one if the cache is full
+
+  private:
+    List<ExecImage *> *images;	// cached images, most recently used first
+    int maxImages;		// how many images we keep at most
+    int numHits;		// # of lookups satisfied by the cache
+    int numMisses;		// # of lookups that had to read the file
+};
+
+#endif // EXECCACHE_H
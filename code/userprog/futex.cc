@@ -0,0 +1,149 @@
+// futex.cc
+//	Routines to let user threads wait on words of their own memory
+//	(see futex.h).
+//
+//	Interrupts are disabled while the table is used, so checking a
+//	user word and going to sleep on it is atomic.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "futex.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// FutexTable::FutexTable
+// 	Initialize a table with no one waiting.
+//----------------------------------------------------------------------
+
+FutexTable::FutexTable()
+{
+    for (int i = 0; i < NumFutexBuckets; i++) {
+	buckets[i] = NULL;
+    }
+    numWaits = numMismatches = numWakes = 0;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::~FutexTable
+// 	De-allocate the table.  Threads still waiting (whose entries are
+//	on their own stacks) are never woken up.
+//----------------------------------------------------------------------
+
+FutexTable::~FutexTable()
+{
+    DEBUG(dbgSynch, "Futexes: " << numWaits << " waits, " << numMismatches
+		<< " returned at once, " << numWakes << " wakeups");
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Hash
+// 	Return the bucket for a futex.  Words are aligned, so the low
+//	bits of the address don't tell futexes apart.
+//
+//	"space" is the address space the futex is in
+//	"vaddr" is its virtual address
+//----------------------------------------------------------------------
+
+int
+FutexTable::Hash(AddrSpace *space, int vaddr)
+{
+    unsigned int key = ((unsigned int) vaddr >> 2)
+			^ ((unsigned int) (long) space >> 4);
+
+    return (key ^ (key >> 8)) & (NumFutexBuckets - 1);
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wait
+// 	Put the current thread to sleep on the word at "vaddr" in its
+//	address space, unless that word no longer holds "value".
+//	Returns 0 once the thread has been woken up by Wake, 1 if the
+//	value had changed, or -1 if "vaddr" isn't an aligned address
+//	in the address space.
+//
+//	"vaddr" is the virtual address of the word
+//	"value" is the value the caller last saw there
+//----------------------------------------------------------------------
+
+int
+FutexTable::Wait(int vaddr, int value)
+{
+    Thread *thread = kernel->currentThread;
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    FutexWaiter waiter;
+    FutexWaiter **ptr;
+    int current;
+
+    if (!thread->space->IsReadable(vaddr, 4)	// check first: ReadMem
+						// raises an exception
+	    || !kernel->machine->ReadMem(vaddr, 4, &current)) {
+	(void) kernel->interrupt->SetLevel(oldLevel);
+	return -1;
+    }
+    if (current != value) {
+	numMismatches++;
+	(void) kernel->interrupt->SetLevel(oldLevel);
+	return 1;
+    }
+
+    waiter.thread = thread;
+    waiter.space = thread->space;
+    waiter.vaddr = vaddr;
+    waiter.next = NULL;
+    for (ptr = &buckets[Hash(thread->space, vaddr)]; *ptr != NULL;
+						ptr = &(*ptr)->next) {
+	;				// find the end of the bucket
+    }
+    *ptr = &waiter;
+    numWaits++;
+    DEBUG(dbgSynch, thread->getName() << " waits on futex " << vaddr);
+    thread->Sleep(FALSE);
+
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wake
+// 	Wake up the threads that have waited longest on the word at
+//	"vaddr" in the current address space -- at most "count" of them.
+//	Returns how many threads were woken, or -1 if "vaddr" isn't an
+//	aligned address in the address space.
+//
+//	"vaddr" is the virtual address of the word
+//	"count" is the most threads to wake
+//----------------------------------------------------------------------
+
+int
+FutexTable::Wake(int vaddr, int count)
+{
+    AddrSpace *space = kernel->currentThread->space;
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    FutexWaiter **ptr = &buckets[Hash(space, vaddr)];
+    FutexWaiter *waiter;
+    int numWoken = 0;
+
+    if (!space->IsReadable(vaddr, 4)) {
+	(void) kernel->interrupt->SetLevel(oldLevel);
+	return -1;
+    }
+    while (*ptr != NULL && numWoken < count) {
+	waiter = *ptr;
+	if (waiter->space == space && waiter->vaddr == vaddr) {
+	    *ptr = waiter->next;	// take it out of the bucket
+	    DEBUG(dbgSynch, "Waking " << waiter->thread->getName()
+			<< " from futex " << vaddr);
+	    kernel->scheduler->ReadyToRun(waiter->thread);
+	    numWoken++;
+	} else {
+	    ptr = &waiter->next;
+	}
+    }
+    numWakes += numWoken;
+
+    (void) kernel->interrupt->SetLevel(oldLevel);
+    return numWoken;
+}
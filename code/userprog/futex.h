@@ -0,0 +1,74 @@
+// futex.h
+//	Data structures for "fast user-space mutexes": kernel wait queues
+//	that user programs can sleep on, keyed by a word of their own
+//	memory.
+//
+//	A user program keeps the state of its locks (or semaphores, or
+//	whatever) in ordinary words of memory, and updates them without
+//	any help from the kernel as long as no thread has to wait.  Only
+//	then does it trap, with FutexWait: "put me to sleep, provided the
+//	word at this address still holds this value".  The check and the
+//	sleep are atomic, so a wakeup that comes between the program's
+//	own check and the trap can't be lost -- the value will have
+//	changed, and FutexWait returns at once.  A thread that changes the
+//	word, and knows (from the word) that threads may be waiting, calls
+//	FutexWake to wake some of them.
+//
+//	Waiting threads are kept in a hash table, keyed by address space
+//	and virtual address, so that each wakeup only looks at threads
+//	waiting on words that hash alike.  Nothing is allocated: each
+//	waiter's entry lives on its own kernel stack while it sleeps.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "copyright.h"
+#include "thread.h"
+
+// Number of buckets in the futex hash table; must be a power of two.
+const int NumFutexBuckets = 64;
+
+// The following class defines a thread waiting on a futex.
+
+class FutexWaiter {
+  public:
+    Thread *thread;		// the thread that is waiting
+    AddrSpace *space;		// the address space, and
+    int vaddr;			// the virtual address, it waits on
+    FutexWaiter *next;		// next waiter in the same bucket
+};
+
+// The following class defines the table of all the threads waiting
+// on futexes.
+
+class FutexTable {
+  public:
+    FutexTable();		// initialize an empty table
+    ~FutexTable();		// de-allocate the table
+
+    int Wait(int vaddr, int value);
+				// sleep until woken, if the word at
+				// "vaddr" still holds "value"
+    int Wake(int vaddr, int count);
+				// wake up to "count" threads waiting
+				// on "vaddr"
+
+  private:
+    FutexWaiter *buckets[NumFutexBuckets];
+				// waiters, in the order they started
+				// waiting, hashed by key
+
+    int Hash(AddrSpace *space, int vaddr);
+				// which bucket a key goes in
+
+    int numWaits;		// # of threads that went to sleep
+    int numMismatches;		// # of waits that returned at once,
+				// since the value had changed
+    int numWakes;		// # of threads woken up
+};
+
+#endif // FUTEX_H
@@ -14,6 +14,7 @@
 #include "kernel.h"
 
 #include "synchconsole.h"
+#include "futex.h"
 
 
 void SysHalt()
@@ -64,4 +65,81 @@ int SysClose(OpenFileId id)
   return kernel->fileSystem->CloseFile_MP1_(id);
 }
 
+SpaceId SysExec(char *name)
+{
+  SchedParams params(kernel->currentThread->getTickets());
+
+  params.priority = kernel->currentThread->getPriority();
+  return kernel->Exec(name, &params);
+}
+
+SpaceId SysExecV(int argc, char **argv)
+{
+  SchedParams params(kernel->currentThread->getTickets());
+
+  params.priority = kernel->currentThread->getPriority();
+  return kernel->ExecV(argc, argv, &params);
+}
+
+int SysJoin(SpaceId id)
+{
+  return kernel->Join(id);
+}
+
+ThreadId SysThreadFork(int func, int retAddr)
+{
+  return kernel->ForkThread(func, retAddr);
+}
+
+void SysThreadYield()
+{
+  kernel->currentThread->Yield();
+}
+
+int SysThreadJoin(ThreadId id)
+{
+  return kernel->currentThread->space->JoinThread(id);
+}
+
+void SysThreadExit(int status)
+{
+  kernel->ExitThread(status);
+}
+
+int SysSetTickets(int tickets)
+{
+  int old = kernel->currentThread->getTickets();
+
+  if (tickets <= 0) {
+    return -1;
+  }
+  kernel->currentThread->setTickets(tickets);
+  return old;
+}
+
+int SysSetRealTime(int period, int budget)
+{
+  IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+  bool admitted = kernel->scheduler->SetRealTime(kernel->currentThread,
+						  period, budget);
+
+  (void) kernel->interrupt->SetLevel(oldLevel);
+  return (admitted ? 0 : -1);
+}
+
+int SysFutexWait(int vaddr, int value)
+{
+  return kernel->futexTable->Wait(vaddr, value);
+}
+
+int SysFutexWake(int vaddr, int count)
+{
+  return kernel->futexTable->Wake(vaddr, count);
+}
+
+void SysExit(int status)
+{
+  kernel->ExitProcess(status);
+}
+
 #endif /* ! __USERPROG_KSYSCALL_H__ */
@@ -5,9 +5,21 @@
  *	code (read-only), initialized data, and unitialized data
  */
 
+#ifndef NOFF_H
+#define NOFF_H
+
 #define NOFFMAGIC	0xbadfad 	/* magic number denoting Nachos 
 					 * object code file 
 					 */
+#define NOFFPAGEDMAGIC	0xbadfae	/* same header, but the segments are
+					 * laid out as a page-aligned image
+					 * of the address space: each segment
+					 * is at file offset virtualAddr +
+					 * NOFFPAGESIZE (see coff2noff -p)
+					 */
+#define NOFFPAGESIZE	128		/* must be the same as PageSize
+					 * in machine/machine.h
+					 */
 
 typedef struct segment {
   int virtualAddr;		/* location of segment in virt addr space */
@@ -26,3 +38,5 @@ typedef struct noffHeader {
 				 * should be zero'ed before use 
 				 */
 } NoffHeader;
+
+#endif /* NOFF_H */
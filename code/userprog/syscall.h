@@ -35,6 +35,10 @@
 #define SC_ThreadExit   14
 #define SC_ThreadJoin   15
 #define SC_PrintInt     16  // 定義SC_PrintInt for MP_1 part2  9_30_8:03 更改
+#define SC_SetTickets   17
+#define SC_SetRealTime  18
+#define SC_FutexWait    19
+#define SC_FutexWake    20
 #define SC_Add		    42
 #define SC_MSG		    100
 
@@ -70,7 +74,11 @@ void MSG(char *msg);
 
 /* Address space control operations: Exit, Exec, Execv, and Join */
 
-/* This user program is done (status = 0 means exited normally). */
+/* This user program is done (status = 0 means exited normally).
+ * Only the calling thread stops: if the program has forked other
+ * threads, it exits (with this status) once they have all called
+ * ThreadExit.
+ */
 void Exit(int status);	
 
 /* A unique identifier for an executing user program (address space) */
@@ -162,8 +170,11 @@ int Close(OpenFileId id);
  */
 
 /* Fork a thread to run a procedure ("func") in the *same* address space 
- * as the current thread.
+ * as the current thread, on a user stack of its own.  If "func"
+ * returns, the thread exits as if it had called ThreadExit, with
+ * whatever "func" left as its return value as the exit code.
  * Return a positive ThreadId on success, negative error code on failure
+ * (the program's first thread is ThreadId 0).
  */
 ThreadId ThreadFork(void (*func)());
 
@@ -174,7 +185,8 @@ void ThreadYield();
 
 /*
  * Blocks current thread until lokal thread ThreadID exits with ThreadExit.
- * Function returns the ExitCode of ThreadExit() of the exiting thread.
+ * Function returns the ExitCode of ThreadExit() of the exiting thread,
+ * or -1 if there is no such thread (or it has already been joined).
  */
 int ThreadJoin(ThreadId id);
 
@@ -183,6 +195,42 @@ int ThreadJoin(ThreadId id);
  */
 void ThreadExit(int ExitCode);	
 
+/*
+ * Set the number of tickets the current thread holds, i.e. its share
+ * of the CPU under the stride and lottery schedulers.  Programs it
+ * Exec's start out with the same number.  Returns the previous
+ * number of tickets, or -1 if "tickets" is not positive.
+ */
+int SetTickets(int tickets);
+
+/*
+ * Put the current thread in the real-time class: it is guaranteed
+ * "budget" ticks of CPU time in every "period" ticks, and real-time
+ * threads run earliest deadline first, ahead of everything else.
+ * A period of 0 puts it back in the normal class.  Returns 0, or -1
+ * if the reservation can't be granted (the CPU is already fully
+ * reserved, or the budget is larger than the period).
+ */
+int SetRealTime(int period, int budget);
+
+/*
+ * Futexes: let threads that share memory wait for each other without
+ * busy-waiting, and without trapping into the kernel unless they have
+ * to wait.
+ *
+ * FutexWait puts the current thread to sleep on the word at "addr",
+ * provided it still holds "value" (checking and going to sleep are
+ * atomic).  Returns 0 once woken by FutexWake, 1 at once if the word
+ * no longer holds "value", or -1 if "addr" isn't a valid, word-aligned
+ * address.
+ *
+ * FutexWake wakes up to "count" of the threads waiting on the word at
+ * "addr", longest-waiting first, and returns how many it woke, or -1
+ * if "addr" isn't a valid, word-aligned address.
+ */
+int FutexWait(int *addr, int value);
+int FutexWake(int *addr, int count);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
@@ -10,6 +10,12 @@
  * 	ld with  -N -T 0
  * to make sure the object file has no shared text.
  *
+ * With -p, the segments are not packed back to back; instead each one
+ * is put at file offset (virtual address + NOFFPAGESIZE), so that the
+ * file is a page-aligned image of the address space, and the header is
+ * marked with NOFFPAGEDMAGIC.  The Nachos loader can then read whole
+ * pages of the file straight into memory.
+ *
  * Also assumes that the COFF file has at most 3 segments:
  *	.text	-- read-only executable instructions 
  *	.data	-- initialized data
@@ -127,6 +133,17 @@ SwapHeader (NoffHeader *noffH)
 #define ReadStruct(f,s) 	Read(f,(char *)&s,sizeof(s))
 
 char *noffFileName = NULL;
+int paged = 0;			/* emit the page-aligned layout (-p) */
+
+/* where in the NOFF file does a segment go?  "packedOffset" is where
+ * it goes if segments are packed back to back */
+int FileOffset(int packedOffset, int virtualAddr)
+{
+    if (paged) {
+	return NOFFPAGESIZE + virtualAddr;
+    }
+    return packedOffset;
+}
 
 /* read and check for error */
 void Read(int fd, char *buf, int nBytes)
@@ -157,8 +174,17 @@ int main(int argc, char **argv)
     char *buffer;
     NoffHeader noffH;
 
-    if (argc < 2) {
-	fprintf(stderr, "Usage: %s <coffFileName> <noffFileName>\n", argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "-p")) {
+	paged = 1;
+	argv++;
+	argc--;
+    }
+    if (argc < 3) {
+	fprintf(stderr, "Usage: %s [-p] <coffFileName> <noffFileName>\n", argv[0]);
+	exit(1);
+    }
+    if (paged && sizeof(NoffHeader) > NOFFPAGESIZE) {
+	fprintf(stderr, "NOFF header doesn't fit in one page\n");
 	exit(1);
     }
     
@@ -211,7 +237,7 @@ int main(int argc, char **argv)
  /* initialize the NOFF header, in case not all the segments are defined
   * in the COFF file
   */
-    noffH.noffMagic = NOFFMAGIC;
+    noffH.noffMagic = paged ? NOFFPAGEDMAGIC : NOFFMAGIC;
     noffH.code.size = 0;
     noffH.initData.size = 0;
     noffH.uninitData.size = 0;
@@ -232,22 +258,26 @@ int main(int argc, char **argv)
 		/* do nothing! */	
 	} else if (!strcmp(sections[i].s_name, ".text")) {
 	    noffH.code.virtualAddr = sections[i].s_paddr;
-	    noffH.code.inFileAddr = inNoffFile;
+	    noffH.code.inFileAddr = FileOffset(inNoffFile,
+						sections[i].s_paddr);
 	    noffH.code.size = sections[i].s_size;
     	    lseek(fdIn, sections[i].s_scnptr, 0);
     	    buffer = malloc(sections[i].s_size);
     	    Read(fdIn, buffer, sections[i].s_size);
+    	    lseek(fdOut, noffH.code.inFileAddr, 0);
     	    Write(fdOut, buffer, sections[i].s_size);
     	    free(buffer);
 	    inNoffFile += sections[i].s_size;
  	} else if (!strcmp(sections[i].s_name, ".data")){
 
 	    noffH.initData.virtualAddr = sections[i].s_paddr;
-	    noffH.initData.inFileAddr = inNoffFile;
+	    noffH.initData.inFileAddr = FileOffset(inNoffFile,
+						sections[i].s_paddr);
 	    noffH.initData.size = sections[i].s_size;
 	    lseek(fdIn, sections[i].s_scnptr, 0);
 	    buffer = malloc(sections[i].s_size);
 	    Read(fdIn, buffer, sections[i].s_size);
+	    lseek(fdOut, noffH.initData.inFileAddr, 0);
 	    Write(fdOut, buffer, sections[i].s_size);
 	    free(buffer);
 	    inNoffFile += sections[i].s_size;
@@ -255,11 +285,13 @@ int main(int argc, char **argv)
 	} else if (!strcmp(sections[i].s_name, ".rdata")){
 
 	    noffH.readonlyData.virtualAddr = sections[i].s_paddr;
-	    noffH.readonlyData.inFileAddr = inNoffFile;
+	    noffH.readonlyData.inFileAddr = FileOffset(inNoffFile,
+						sections[i].s_paddr);
 	    noffH.readonlyData.size = sections[i].s_size;
 	    lseek(fdIn, sections[i].s_scnptr, 0);
 	    buffer = malloc(sections[i].s_size);
 	    Read(fdIn, buffer, sections[i].s_size);
+	    lseek(fdOut, noffH.readonlyData.inFileAddr, 0);
 	    Write(fdOut, buffer, sections[i].s_size);
 	    free(buffer);
 	    inNoffFile += sections[i].s_size;